@@ -0,0 +1,224 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ByteScanner.hxx"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* the vector kernels need x86 intrinsics and a compiler that builds them for
+ * one function at a time, so that the rest of dialect runs anywhere */
+#if defined(HAVE_IMMINTRIN_H) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define BYTE_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ByteScanner */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+/* ////////////////////////////////////////////////////////////////////////// */
+ByteScanner::ByteScanner(const SymbolID *byteTerminals, const char *dropped) :
+    nruns(0),
+    ndrop(0)
+{
+    memset(this->lows, 0, sizeof(this->lows));
+    memset(this->highs, 0, sizeof(this->highs));
+    for (unsigned b = 0; b < 256; ++b) {
+        this->kinds[b] = SymbolTable::NONE != byteTerminals[b];
+    }
+    for (; '\0' != dropped[this->ndrop] && this->ndrop < MAX_DROPPED;
+         ++this->ndrop) {
+        this->drop[this->ndrop] = dropped[this->ndrop];
+        this->kinds[this->drop[this->ndrop]] = 2;
+    }
+    for (unsigned b = 0; b < 256; ++b) {
+        if (0 == this->kinds[b]) continue;
+        uint8_t *row = b < 0x80 ? this->lows : this->highs;
+        row[b & 15] |= uint8_t(1) << ((b >> 4) & 7);
+        /* the last run grows or a new one starts. past MAX_RUNS, only the
+         * count is kept. */
+        bool grows = 0 < b && 0 != this->kinds[b - 1];
+        if (!grows) ++this->nruns;
+        if (MAX_RUNS < this->nruns) continue;
+        if (grows) ++this->runSpan[this->nruns - 1];
+        else {
+            this->runFirst[this->nruns - 1] = b;
+            this->runSpan[this->nruns - 1] = 0;
+        }
+    }
+    this->kernel = scanScalar;
+#ifdef BYTE_SCANNER_X86
+    const char *pick = getenv("DIALECT_BYTE_SCAN");
+    __builtin_cpu_init();
+    bool avx2 = __builtin_cpu_supports("avx2");
+    bool sse2 = __builtin_cpu_supports("sse2") && this->nruns <= MAX_RUNS;
+    /* set DIALECT_BYTE_SCAN to scalar, sse2, or avx2 to ask for a kernel */
+    if (NULL != pick && 0 == strcmp(pick, "scalar")) avx2 = sse2 = false;
+    if (NULL != pick && 0 == strcmp(pick, "sse2")) avx2 = false;
+    if (avx2) this->kernel = scanAVX2;
+    else if (sse2) this->kernel = scanSSE2;
+#endif
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+const char *
+ByteScanner::kernelName(void) const
+{
+    if (scanAVX2 == this->kernel) return "avx2";
+    if (scanSSE2 == this->kernel) return "sse2";
+    return "scalar";
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+size_t
+ByteScanner::scanScalar(const ByteScanner &s,
+                        const uint8_t *begin,
+                        const uint8_t *end,
+                        size_t &dropped)
+{
+    for (const uint8_t *b = begin; end != b; ++b) {
+        uint8_t kind = s.kinds[*b];
+        if (0 == kind) return b - begin;
+        dropped += kind >> 1;
+    }
+    return end - begin;
+}
+
+#ifdef BYTE_SCANNER_X86
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a byte x is in the run [first, first + span] if x - first, wrapped around,
+ * is no more than span, and SSE2 has an unsigned byte min to say so */
+__attribute__((target("sse2")))
+size_t
+ByteScanner::scanSSE2(const ByteScanner &s,
+                      const uint8_t *begin,
+                      const uint8_t *end,
+                      size_t &dropped)
+{
+    __m128i firsts[MAX_RUNS], spans[MAX_RUNS], drops[MAX_DROPPED];
+    const uint8_t *b = begin;
+
+    for (size_t r = 0; r < s.nruns; ++r) {
+        firsts[r] = _mm_set1_epi8(char(s.runFirst[r]));
+        spans[r] = _mm_set1_epi8(char(s.runSpan[r]));
+    }
+    for (size_t d = 0; d < s.ndrop; ++d) {
+        drops[d] = _mm_set1_epi8(char(s.drop[d]));
+    }
+    for (; 16 <= end - b; b += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+        __m128i ok = _mm_setzero_si128(), gone = _mm_setzero_si128();
+        for (size_t r = 0; r < s.nruns; ++r) {
+            __m128i x = _mm_sub_epi8(v, firsts[r]);
+            __m128i in = _mm_cmpeq_epi8(_mm_min_epu8(x, spans[r]), x);
+            ok = _mm_or_si128(ok, in);
+        }
+        for (size_t d = 0; d < s.ndrop; ++d) {
+            gone = _mm_or_si128(gone, _mm_cmpeq_epi8(v, drops[d]));
+        }
+        uint32_t bad = ~uint32_t(_mm_movemask_epi8(ok)) & 0xffff;
+        uint32_t out = _mm_movemask_epi8(gone);
+        if (0 != bad) {
+            uint32_t at = __builtin_ctz(bad);
+            dropped += __builtin_popcount(out & ((uint32_t(1) << at) - 1));
+            return b - begin + at;
+        }
+        dropped += __builtin_popcount(out);
+    }
+    return b - begin + scanScalar(s, b, end, dropped);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the low nibble of each byte picks a row of the bitmap and the high nibble
+ * picks a bit of it. both lookups are one vpshufb each, per 128-bit lane, so
+ * the tables are in both lanes. */
+__attribute__((target("avx2")))
+size_t
+ByteScanner::scanAVX2(const ByteScanner &s,
+                      const uint8_t *begin,
+                      const uint8_t *end,
+                      size_t &dropped)
+{
+    const __m256i lows = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(s.lows)));
+    const __m256i highs = _mm256_broadcastsi128_si256(
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(s.highs)));
+    const __m256i bits = _mm256_setr_epi8(
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128,
+        1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    const __m256i seven = _mm256_set1_epi8(7);
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i drops[MAX_DROPPED];
+    const uint8_t *b = begin;
+
+    for (size_t d = 0; d < s.ndrop; ++d) {
+        drops[d] = _mm256_set1_epi8(char(s.drop[d]));
+    }
+    for (; 32 <= end - b; b += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(b));
+        __m256i lo = _mm256_and_si256(v, nibble);
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble);
+        __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(lows, lo),
+                                         _mm256_shuffle_epi8(highs, lo),
+                                         _mm256_cmpgt_epi8(hi, seven));
+        __m256i bit = _mm256_shuffle_epi8(bits, hi);
+        __m256i miss = _mm256_cmpeq_epi8(_mm256_and_si256(row, bit), zero);
+        __m256i gone = zero;
+        for (size_t d = 0; d < s.ndrop; ++d) {
+            gone = _mm256_or_si256(gone, _mm256_cmpeq_epi8(v, drops[d]));
+        }
+        uint32_t bad = _mm256_movemask_epi8(miss);
+        uint32_t out = _mm256_movemask_epi8(gone);
+        if (0 != bad) {
+            uint32_t at = __builtin_ctz(bad);
+            dropped += __builtin_popcount(out & ((uint32_t(1) << at) - 1));
+            return b - begin + at;
+        }
+        dropped += __builtin_popcount(out);
+    }
+    return b - begin + scanScalar(s, b, end, dropped);
+}
+
+#else
+
+/* ////////////////////////////////////////////////////////////////////////// */
+size_t
+ByteScanner::scanSSE2(const ByteScanner &s,
+                      const uint8_t *begin,
+                      const uint8_t *end,
+                      size_t &dropped)
+{
+    return scanScalar(s, begin, end, dropped);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+size_t
+ByteScanner::scanAVX2(const ByteScanner &s,
+                      const uint8_t *begin,
+                      const uint8_t *end,
+                      size_t &dropped)
+{
+    return scanScalar(s, begin, end, dropped);
+}
+
+#endif
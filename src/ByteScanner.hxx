@@ -0,0 +1,100 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BYTE_SCANNER_H_INCLUDED
+#define BYTE_SCANNER_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "Symbol.hxx"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* byte scanner class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* sorts input bytes three ways before anything is parsed: terminals of the
+ * grammar, bytes that are dropped from the input (newlines), and bytes that
+ * are neither and so can never be parsed. the kernel is picked at run time:
+ * AVX2 looks each byte up in a nibble-indexed bitmap and takes any alphabet,
+ * SSE2 compares against up to MAX_RUNS runs of consecutive bytes, and
+ * anything else goes through a 256-entry table a byte at a time. */
+class ByteScanner {
+public:
+    enum { MAX_RUNS = 8, MAX_DROPPED = 4 };
+
+private:
+    /* a byte b is allowed if bit (b >> 4) & 7 of lows[b & 15] is set, for
+     * b < 0x80, or of highs[b & 15] otherwise. allowed bytes are terminals
+     * and dropped bytes both. */
+    uint8_t lows[16];
+    uint8_t highs[16];
+    /* allowed bytes again, as [runFirst[r], runFirst[r] + runSpan[r]] */
+    uint8_t runFirst[MAX_RUNS];
+    uint8_t runSpan[MAX_RUNS];
+    size_t nruns;
+    /* what is dropped */
+    uint8_t drop[MAX_DROPPED];
+    size_t ndrop;
+    /* 0 for illegal bytes, 1 for terminals, 2 for dropped bytes */
+    uint8_t kinds[256];
+    /* the kernel scan() runs */
+    size_t (*kernel)(const ByteScanner &,
+                     const uint8_t *,
+                     const uint8_t *,
+                     size_t &);
+
+    static size_t scanScalar(const ByteScanner &s,
+                             const uint8_t *begin,
+                             const uint8_t *end,
+                             size_t &dropped);
+
+    static size_t scanSSE2(const ByteScanner &s,
+                           const uint8_t *begin,
+                           const uint8_t *end,
+                           size_t &dropped);
+
+    static size_t scanAVX2(const ByteScanner &s,
+                           const uint8_t *begin,
+                           const uint8_t *end,
+                           size_t &dropped);
+
+public:
+    /* terminals are the bytes byteTerminals maps to something other than
+     * NONE, as in SymbolTable::byteTerminals(). dropped is at most
+     * MAX_DROPPED bytes long. */
+    ByteScanner(const SymbolID *byteTerminals, const char *dropped = "\n");
+
+    ~ByteScanner(void) { ; }
+
+    /* the offset of the first byte in [begin, end) that is neither a
+     * terminal nor dropped, or end - begin if there is none. dropped gets
+     * the number of dropped bytes before it. */
+    size_t scan(const char *begin, const char *end, size_t &dropped) const {
+        dropped = 0;
+        return this->kernel(*this, reinterpret_cast<const uint8_t *>(begin),
+                            reinterpret_cast<const uint8_t *>(end), dropped);
+    }
+
+    /* "avx2", "sse2", or "scalar" */
+    const char *kernelName(void) const;
+};
+
+#endif
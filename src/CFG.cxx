@@ -23,6 +23,10 @@
 #include <string>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 using namespace std;
 
@@ -35,18 +39,18 @@ using namespace std;
 /* ////////////////////////////////////////////////////////////////////////// */
 template <typename T>
 static void
-emitAllMembers(const T &t, bool nls = true)
+emitAllMembers(const SymbolTable &symbols, const T &t, bool nls = true)
 {
     if (nls) {
         for (auto member = t.begin(); t.end() != member; ++member) {
-            dout << "  " << *member << endl;
+            dout << "  " << symbols.name(*member) << endl;
         }
     }
     else {
         cout << "{";
         for (auto member = t.begin(); t.end() != member; ++member) {
             if (member != t.begin()) cout << ", ";
-            cout << *member;
+            cout << symbols.name(*member);
         }
         cout << "}" << endl;
     }
@@ -54,205 +58,196 @@ emitAllMembers(const T &t, bool nls = true)
 
 /* ////////////////////////////////////////////////////////////////////////// */
 static void
-propagateFollows(CFGProductions &productions,
-                 const Symbol &s)
+emitAllProductions(const SymbolTable &symbols,
+                   const CFGProductions &productions)
 {
-    Symbol t = s;
-
-    for (CFGProduction &p : productions) {
-        if (t == p.lhs()) {
-            p.lhs().follows().insert(t.follows().begin(), t.follows().end());
-        }
-        for (Symbol &sym : p.rhs()) {
-            if (t == sym) {
-                sym.follows().insert(t.follows().begin(), t.follows().end());
-            }
-        }
+    for (size_t p = 0; p < productions.size(); ++p) {
+        dout << "  " << productions.str(p, symbols) << endl;
     }
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static void
-propagateMark(CFGProductions &productions,
-              const Symbol &symbol)
+/* returns all the symbols that appear in productions in id order */
+static vector<SymbolID>
+occurringSymbols(const SymbolTable &symbols,
+                 const CFGProductions &productions)
 {
-    for (CFGProduction &p : productions) {
-        if (symbol == p.lhs()) p.lhs().mark(true);
-        for (Symbol &sym : p.rhs()) {
-            if (symbol == sym) sym.mark(true);
+    vector<bool> seen(symbols.size(), false);
+    vector<SymbolID> res;
+
+    for (size_t p = 0; p < productions.size(); ++p) {
+        seen[productions.lhs(p)] = true;
+        const SymbolID *rend = productions.rhsEnd(p);
+        for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+            seen[*s] = true;
         }
     }
-}
-
-/* ////////////////////////////////////////////////////////////////////////// */
-static void
-propagateNullable(CFGProductions &productions,
-                  const Symbol &symbol)
-{
-    for (CFGProduction &p : productions) {
-        if (symbol == p.lhs()) p.lhs().nullable(true);
-        for (Symbol &sym : p.rhs()) {
-            if (symbol == sym) sym.nullable(true);
-        }
+    for (SymbolID id = 0; id < symbols.size(); ++id) {
+        if (seen[id]) res.push_back(id);
     }
+    return res;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static void
-propagateFirsts(CFGProductions &productions,
-                const Symbol &symbol,
-                const set<Symbol> &fset)
-{
-    for (CFGProduction &p : productions) {
-        if (symbol == p.lhs()) {
-            p.lhs().firsts().insert(fset.begin(), fset.end());
-        }
-        for (Symbol &sym : p.rhs()) {
-            if (symbol == sym) {
-                sym.firsts().insert(fset.begin(), fset.end());
-            }
-        }
-    }
-}
-
 /* ////////////////////////////////////////////////////////////////////////// */
-template <typename T>
-static bool
-lastElem(const T &l)
-{
-    typename T::const_iterator i = l.begin();
-    bool res = false;
-
-    ++i; res = (l.end() == i); --i;
-    return res;
-}
-
+/* CFGProduction */
 /* ////////////////////////////////////////////////////////////////////////// */
-static void
-emitNullables(const CFGProductions &productions)
-{
-    set<Symbol> nullables;
-
-    for (CFGProduction p : productions) {
-        if (p.lhs().nullable() && !p.lhs().terminal()) {
-            nullables.insert(p.lhs());
-        }
-        for (const Symbol &s : p.rhs()) {
-            if (s.nullable() && !s.terminal()) nullables.insert(s);
-        }
-    }
-    if (0 != nullables.size()) {
-        dout << "here are the nullable non-terminals: ";
-        emitAllMembers(nullables, false);
-    }
-    else {
-        dout << "did not find nullable non-terminals..." << endl;
-    }
-}
-
 /* ////////////////////////////////////////////////////////////////////////// */
-static void
-emitFollowSets(const CFGProductions &productions)
+CFGProduction::CFGProduction(SymbolTable &symbols,
+                             const string &lhs,
+                             const string &rhs)
 {
-    set<Symbol> lhsSet;
-    for (const CFGProduction &p : productions) {
-        lhsSet.insert(const_cast<CFGProduction &>(p).lhs());
-        vector<Symbol> rhs = const_cast<CFGProduction &>(p).rhs();
-        lhsSet.insert(rhs.begin(), rhs.end());
-    }
-    for (const Symbol &sym : lhsSet) {
-        dout << "FOLLOW(" << sym << ") = ";
-        emitAllMembers(const_cast<Symbol &>(sym).follows(), false);
+    /* left-hand side symbols are always non-terminals, but we'll just init
+     * everything similarly in this path because we really can't telly anything
+     * about this grammar at this point only given production strings. */
+    this->leftHandSide = symbols.intern(lhs);
+    for (unsigned i = 0; i < rhs.length(); ++i) {
+        /* <name> is one symbol if it names a token declared before */
+        size_t close = '<' == rhs[i] ? rhs.find('>', i) : string::npos;
+        if (string::npos != close) {
+            SymbolID token = symbols.find(rhs.substr(i, close - i + 1));
+            if (SymbolTable::NONE != token) {
+                this->rightHandSide.push_back(token);
+                i = close;
+                continue;
+            }
+        }
+        this->rightHandSide.push_back(symbols.intern(string(&rhs[i], 1)));
     }
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 /* ////////////////////////////////////////////////////////////////////////// */
-/* Symbol */
+/* CFGProductions */
 /* ////////////////////////////////////////////////////////////////////////// */
 /* ////////////////////////////////////////////////////////////////////////// */
 
-/* dead symbol */
-const string Symbol::DEAD    = "_0xDEADBEEF_";
-/* this is okay because our parser makes sure that we can never get a space on
- * either side of any production rule. if this ever changes, then this "special"
- * character will need to be changed. */
-const string Symbol::EPSILON = " ";
-/* our parser doesn't allow multi-char string, so this is okay */
-const string Symbol::START   = "S'";
-/* our scanner doesn't accept $s, so this is okay */
-const string Symbol::END     = "$";
+const uint32_t CFGProductions::NONE = UINT32_MAX;
 
 /* ////////////////////////////////////////////////////////////////////////// */
-bool
-operator==(const Symbol &s1,
-           const Symbol &s2)
+void
+CFGProductions::push_back(SymbolID lhs,
+                          const SymbolID *rhsb,
+                          const SymbolID *rhse,
+                          uint32_t origin)
 {
-    return s1.symbol == s2.symbol;
+    this->lhss.push_back(lhs);
+    this->origins.push_back(origin);
+    this->begins.push_back(static_cast<uint32_t>(this->rhss.size()));
+    this->rhss.insert(this->rhss.end(), rhsb, rhse);
+    this->ends.push_back(static_cast<uint32_t>(this->rhss.size()));
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-bool
-operator!=(const Symbol &s1,
-           const Symbol &s2)
+void
+CFGProductions::push_back(const CFGProduction &p)
 {
-    return s1.symbol != s2.symbol;
+    const SymbolID *rhs = p.rhs().data();
+    this->push_back(p.lhs(), rhs, rhs + p.rhs().size());
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-/* < */
-bool
-operator<(const Symbol &s1,
-          const Symbol &s2)
+CFGProduction
+CFGProductions::at(size_t p) const
 {
-    return s1.symbol < s2.symbol;
+    return CFGProduction(this->lhs(p),
+                         vector<SymbolID>(this->rhsBegin(p), this->rhsEnd(p)));
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-ostream &
-operator<<(ostream &out,
-           const Symbol &symbol)
+void
+CFGProductions::compact(const vector<bool> &keep)
 {
-    out << symbol.symbol;
-    return out;
+    size_t np = 0;
+    uint32_t nr = 0;
+    vector<size_t> order;
+
+    /* holes can put right-hand sides out of order, and moving them left only
+     * works front to back */
+    for (size_t p = 0; p < this->size(); ++p) {
+        if (keep[p]) order.push_back(p);
+    }
+    if (0 != this->holes) {
+        vector<SymbolID> packed;
+        packed.reserve(this->rhss.size() - this->holes);
+        for (size_t p : order) {
+            packed.insert(packed.end(), this->rhsBegin(p), this->rhsEnd(p));
+        }
+        for (size_t p : order) {
+            uint32_t len = this->ends[p] - this->begins[p];
+            this->lhss[np] = this->lhss[p];
+            this->origins[np] = this->origins[p];
+            this->begins[np] = nr;
+            this->ends[np] = nr + len;
+            nr += len;
+            ++np;
+        }
+        this->rhss.swap(packed);
+        this->holes = 0;
+    }
+    else {
+        for (size_t p : order) {
+            uint32_t b = this->begins[p], e = this->ends[p];
+            this->lhss[np] = this->lhss[p];
+            this->origins[np] = this->origins[p];
+            /* nr <= b, so this never clobbers what we have yet to move */
+            copy(this->rhss.begin() + b, this->rhss.begin() + e,
+                 this->rhss.begin() + nr);
+            this->begins[np] = nr;
+            this->ends[np] = nr + (e - b);
+            nr += e - b;
+            ++np;
+        }
+        this->rhss.resize(nr);
+    }
+    this->lhss.resize(np);
+    this->origins.resize(np);
+    this->begins.resize(np);
+    this->ends.resize(np);
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-/* ////////////////////////////////////////////////////////////////////////// */
-/* CFGProduction */
-/* ////////////////////////////////////////////////////////////////////////// */
-/* ////////////////////////////////////////////////////////////////////////// */
-ostream &
-operator<<(ostream &out,
-           const CFGProduction &production)
+void
+CFGProductions::swapRemove(size_t p)
 {
-    out << production.leftHandSide << " --> ";
-    for (const Symbol &p : production.rightHandSide) {
-        out << p;
+    size_t last = this->size() - 1;
+
+    this->holes += this->rhsLength(p);
+    this->lhss[p] = this->lhss[last];
+    this->origins[p] = this->origins[last];
+    this->begins[p] = this->begins[last];
+    this->ends[p] = this->ends[last];
+    this->lhss.pop_back();
+    this->origins.pop_back();
+    this->begins.pop_back();
+    this->ends.pop_back();
+    /* reclaim the holes once they are most of the store */
+    if (2 * this->holes > this->rhss.size()) {
+        this->compact(vector<bool>(this->size(), true));
     }
-    return out;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-CFGProduction::CFGProduction(const string &lhs,
-                             const string &rhs)
+string
+CFGProductions::str(size_t p, const SymbolTable &symbols) const
 {
-    /* left-hand side symbols are always non-terminals, but we'll just init
-     * everything similarly in this path because we really can't telly anything
-     * about this grammar at this point only given production strings. */
-    this->leftHandSide = Symbol(lhs);
-    for (unsigned i = 0; i < rhs.length(); ++i) {
-        /* at this point we don't know what type the symbols are. */
-        this->rightHandSide.push_back(Symbol(string(&rhs[i], 1)));
+    string res = symbols.name(this->lhs(p)) + " --> ";
+
+    if (0 == this->rhsLength(p)) return res + SymbolTable::EPSILON_NAME;
+    for (auto s = this->rhsBegin(p); s != this->rhsEnd(p); ++s) {
+        res += symbols.name(*s);
     }
+    return res;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 bool
-CFGProduction::rhsMarked(void) const
+rhsMarked(const CFGProductions &productions,
+          size_t p,
+          const SymbolMarks &marks)
 {
-    for (const Symbol &sym : this->rightHandSide) {
-        if (!sym.marked()) return false;
+    for (auto s = productions.rhsBegin(p); s != productions.rhsEnd(p); ++s) {
+        if (!marks[*s]) return false;
     }
     return true;
 }
@@ -265,222 +260,685 @@ CFGProduction::rhsMarked(void) const
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-GeneratingMarker::mark(CFGProductions &productions) const
+GeneratingMarker::mark(const SymbolTable &symbols,
+                       SymbolMarks &marks) const
 {
     /* init the symbol markers by marking all terminals and making sure that
      * non-terminals aren't marked at this point. */
-    for (CFGProduction &p : productions) {
-        p.lhs().mark(p.lhs().terminal());
-        for (Symbol &sym : p.rhs()) {
-            sym.mark(sym.terminal());
-        }
+    marks.assign(symbols.size(), false);
+    for (SymbolID id = 0; id < symbols.size(); ++id) {
+        marks[id] = symbols.terminal(id);
     }
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-ReachabilityMarker::mark(CFGProductions &productions) const
+ReachabilityMarker::mark(const SymbolTable &symbols,
+                         SymbolMarks &marks) const
 {
     /* this one is easy. mark the start symbol. */
-    for (CFGProduction &p : productions) {
-        p.lhs().mark(p.lhs().start());
-        for (Symbol &sym : p.rhs()) {
-            sym.mark(sym.start());
-        }
-    }
+    marks.assign(symbols.size(), false);
+    marks[SymbolTable::START] = true;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-NullableMarker::mark(CFGProductions &productions) const
+NullableMarker::mark(const SymbolTable &symbols,
+                     SymbolMarks &marks) const
 {
-    for (CFGProduction &p : productions) {
-        p.lhs().mark(p.lhs().epsilon());
-        for (Symbol &sym : p.rhs()) {
-            sym.mark(sym.epsilon());
-        }
-    }
+    /* epsilon is an empty right-hand side, so nothing starts out marked. */
+    marks.assign(symbols.size(), false);
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-NonGeneratingEraser::erase(CFGProductions &productions) const
+NonGeneratingEraser::erase(const SymbolTable &symbols,
+                           CFGProductions &productions,
+                           const SymbolMarks &marks) const
 {
+    vector<bool> keep(productions.size(), true);
     bool rm = false;
     if (this->verbose) {
         dout << "removing non-generating symbols..." << endl;
     }
-    for (auto p = productions.begin(); productions.end() != p;) {
-        if (!p->lhs().marked() || !p->rhsMarked()) {
-            if (this->verbose) dout << "  rm " << *p << endl;
+    for (size_t p = 0; p < productions.size(); ++p) {
+        if (!marks[productions.lhs(p)] || !rhsMarked(productions, p, marks)) {
+            if (this->verbose) {
+                dout << "  rm " << productions.str(p, symbols) << endl;
+            }
             rm = true;
-            p = productions.erase(p);
+            keep[p] = false;
         }
-        else ++p;
     }
+    productions.compact(keep);
     if (!rm && this->verbose) dout << "  none found" << endl;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-UnreachableEraser::erase(CFGProductions &productions) const
+UnreachableEraser::erase(const SymbolTable &symbols,
+                         CFGProductions &productions,
+                         const SymbolMarks &marks) const
 {
+    vector<bool> keep(productions.size(), true);
     bool rm = false;
     if (this->verbose) {
         dout << "removing unreachable symbols..." << endl;
     }
-    for (auto p = productions.begin(); productions.end() != p;) {
-        if (!p->lhs().marked()) {
-            if (this->verbose) dout << "  rm " << *p << endl;
+    for (size_t p = 0; p < productions.size(); ++p) {
+        if (!marks[productions.lhs(p)]) {
+            if (this->verbose) {
+                dout << "  rm " << productions.str(p, symbols) << endl;
+            }
             rm = true;
-            p = productions.erase(p);
+            keep[p] = false;
         }
-        else ++p;
     }
+    productions.compact(keep);
     if (!rm && this->verbose) dout << "  none found" << endl;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
+/* reverse index from symbol ids to productions in compressed sparse row form:
+ * symbol s owns prods[offsets[s], offsets[s + 1]). when rhs is true, a
+ * production is listed once for every right-hand side occurrence of s.
+ * otherwise, it is listed under its left-hand side. */
+static void
+buildSymbolIndex(const CFGProductions &productions,
+                 size_t nsymbols,
+                 bool rhs,
+                 vector<uint32_t> &offsets,
+                 vector<uint32_t> &prods)
+{
+    offsets.assign(nsymbols + 1, 0);
+    for (size_t p = 0; p < productions.size(); ++p) {
+        if (!rhs) { ++offsets[productions.lhs(p) + 1]; continue; }
+        const SymbolID *rend = productions.rhsEnd(p);
+        for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+            ++offsets[*s + 1];
+        }
+    }
+    for (size_t s = 0; s < nsymbols; ++s) offsets[s + 1] += offsets[s];
+    prods.resize(offsets[nsymbols]);
+    vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t p = 0; p < productions.size(); ++p) {
+        if (!rhs) { prods[fill[productions.lhs(p)]++] = p; continue; }
+        const SymbolID *rend = productions.rhsEnd(p);
+        for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+            prods[fill[*s]++] = p;
+        }
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* level-synchronous frontier expansion on a thread pool. expand(id, out)
+ * appends the symbols that id caused to be marked to out. */
+static void
+expandFrontier(ThreadPool &pool,
+               vector<SymbolID> &frontier,
+               const function<void(SymbolID, vector<SymbolID> &)> &expand)
+{
+    mutex mtx;
+
+    while (!frontier.empty()) {
+        vector<SymbolID> next;
+        size_t grain = max(size_t(64), frontier.size() / (pool.size() * 8));
+        pool.parallelFor(frontier.size(), [&](size_t b, size_t e) {
+            vector<SymbolID> local;
+            for (size_t i = b; i < e; ++i) expand(frontier[i], local);
+            lock_guard<mutex> lock(mtx);
+            next.insert(next.end(), local.begin(), local.end());
+        }, grain);
+        frontier.swap(next);
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static unique_ptr<atomic<bool>[]>
+atomicMarks(const SymbolMarks &marks)
+{
+    unique_ptr<atomic<bool>[]> res(new atomic<bool>[marks.size()]);
+    for (size_t id = 0; id < marks.size(); ++id) res[id] = marks[id];
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* worklist of reachable symbols: every symbol is expanded at most once, so
+ * every production is walked at most once. */
 void
-UnreachableHygiene::go(CFGProductions &productions) const
-{
-    bool hadUpdate;
-    do {
-        hadUpdate = false;
-        for (CFGProduction &p : productions) {
-            if (p.lhs().marked() && !p.rhsMarked()) {
-                for (Symbol &sym : p.rhs()) {
-                    propagateMark(productions, sym.sym());
+UnreachableHygiene::go(const CFGProductions &productions,
+                       SymbolMarks &marks) const
+{
+    vector<uint32_t> offsets, byLHS;
+    vector<SymbolID> work;
+
+    buildSymbolIndex(productions, marks.size(), false, offsets, byLHS);
+    for (SymbolID id = 0; id < marks.size(); ++id) {
+        if (marks[id]) work.push_back(id);
+    }
+    if (this->pool && this->pool->size() > 1) {
+        auto amarks = atomicMarks(marks);
+        expandFrontier(*this->pool, work, [&](SymbolID id,
+                                              vector<SymbolID> &out) {
+            for (uint32_t i = offsets[id]; i < offsets[id + 1]; ++i) {
+                uint32_t p = byLHS[i];
+                const SymbolID *rend = productions.rhsEnd(p);
+                for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+                    if (!amarks[*s].exchange(true)) out.push_back(*s);
                 }
-                hadUpdate = true;
+            }
+        });
+        for (size_t id = 0; id < marks.size(); ++id) marks[id] = amarks[id];
+        return;
+    }
+    while (!work.empty()) {
+        SymbolID id = work.back(); work.pop_back();
+        for (uint32_t i = offsets[id]; i < offsets[id + 1]; ++i) {
+            uint32_t p = byLHS[i];
+            const SymbolID *rend = productions.rhsEnd(p);
+            for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+                if (marks[*s]) continue;
+                marks[*s] = true;
+                work.push_back(*s);
             }
         }
-    } while (hadUpdate);
+    }
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
+/* every production keeps the number of its right-hand side symbols that are
+ * still unmarked. marking a symbol decrements the count of every production it
+ * appears in, and a production whose count drops to zero marks its left-hand
+ * side. every occurrence is visited at most once. */
 void
-NonGeneratingHygiene::go(CFGProductions &productions) const
-{
-    bool hadUpdate;
-    do {
-        hadUpdate = false;
-        for (CFGProduction &p : productions) {
-            if (!p.lhs().marked() && p.rhsMarked()) {
-                /* make sure that we update all instances of lhs()->sym() */
-                propagateMark(productions, p.lhs().sym());
-                hadUpdate = true;
+NonGeneratingHygiene::go(const CFGProductions &productions,
+                         SymbolMarks &marks) const
+{
+    vector<uint32_t> offsets, byRHS;
+    vector<uint32_t> unmarked(productions.size(), 0);
+    vector<SymbolID> work;
+
+    buildSymbolIndex(productions, marks.size(), true, offsets, byRHS);
+    for (size_t p = 0; p < productions.size(); ++p) {
+        const SymbolID *rend = productions.rhsEnd(p);
+        for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+            if (!marks[*s]) ++unmarked[p];
+        }
+    }
+    for (size_t p = 0; p < productions.size(); ++p) {
+        SymbolID lhs = productions.lhs(p);
+        if (0 == unmarked[p] && !marks[lhs]) {
+            marks[lhs] = true;
+            work.push_back(lhs);
+        }
+    }
+    if (this->pool && this->pool->size() > 1) {
+        auto amarks = atomicMarks(marks);
+        unique_ptr<atomic<uint32_t>[]> aunmarked(
+            new atomic<uint32_t>[unmarked.size()]
+        );
+        for (size_t p = 0; p < unmarked.size(); ++p) {
+            aunmarked[p] = unmarked[p];
+        }
+        expandFrontier(*this->pool, work, [&](SymbolID id,
+                                              vector<SymbolID> &out) {
+            for (uint32_t i = offsets[id]; i < offsets[id + 1]; ++i) {
+                uint32_t p = byRHS[i];
+                if (1 != aunmarked[p].fetch_sub(1)) continue;
+                SymbolID lhs = productions.lhs(p);
+                if (!amarks[lhs].exchange(true)) out.push_back(lhs);
+            }
+        });
+        for (size_t id = 0; id < marks.size(); ++id) marks[id] = amarks[id];
+        return;
+    }
+    while (!work.empty()) {
+        SymbolID id = work.back(); work.pop_back();
+        for (uint32_t i = offsets[id]; i < offsets[id + 1]; ++i) {
+            uint32_t p = byRHS[i];
+            if (0 != --unmarked[p]) continue;
+            SymbolID lhs = productions.lhs(p);
+            if (!marks[lhs]) {
+                marks[lhs] = true;
+                work.push_back(lhs);
             }
         }
-    } while (hadUpdate);
+    }
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 /* ////////////////////////////////////////////////////////////////////////// */
-/* CFG */
+/* production transformation classes */
 /* ////////////////////////////////////////////////////////////////////////// */
 /* ////////////////////////////////////////////////////////////////////////// */
 
 /* ////////////////////////////////////////////////////////////////////////// */
-CFG::CFG(const CFGProductions &productions)
+/* a production while a transformation rewrites it */
+struct RewriteRule {
+    vector<SymbolID> rhs;
+    uint32_t origin;
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* every production by left-hand side. a transformation rewrites the
+ * productions of whatever it touches here and store() writes them back in
+ * place of the old ones, followed by those of the non-terminals it added. */
+class RewriteRules {
+private:
+    /* the non-terminal each added one was added for */
+    vector<SymbolID> owners;
+    /* the non-terminals added for each non-terminal */
+    vector< vector<SymbolID> > added;
+    /* whether or not a non-terminal's productions were rewritten */
+    vector<bool> rewritten;
+
+public:
+    /* productions by left-hand side */
+    vector< vector<RewriteRule> > rules;
+
+    RewriteRules(const SymbolTable &symbols,
+                 const CFGProductions &productions);
+
+    /* a new non-terminal named after base */
+    SymbolID fresh(SymbolTable &symbols, SymbolID base);
+
+    void touch(SymbolID id) { this->rewritten[id] = true; }
+
+    void store(CFGProductions &productions) const;
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+RewriteRules::RewriteRules(const SymbolTable &symbols,
+                           const CFGProductions &productions)
 {
-    this->verbose = false;
-    this->productions = productions;
-    /* add a new, special terminal, $ and new start production */
-    CFGProduction newp(Symbol::START, this->startSymbol().sym() + Symbol::END);
-    this->productions.insert(this->productions.begin(), newp);
-    /* init S''s follow set to include $ */
-    this->productions.begin()->lhs().follows().insert(Symbol(Symbol::END));
-    this->refresh();
+    this->owners.resize(symbols.size());
+    this->added.resize(symbols.size());
+    this->rewritten.assign(symbols.size(), false);
+    this->rules.resize(symbols.size());
+    for (SymbolID id = 0; id < symbols.size(); ++id) this->owners[id] = id;
+    for (size_t p = 0; p < productions.size(); ++p) {
+        RewriteRule rule;
+        rule.rhs.assign(productions.rhsBegin(p), productions.rhsEnd(p));
+        rule.origin = productions.origin(p);
+        this->rules[productions.lhs(p)].push_back(rule);
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+SymbolID
+RewriteRules::fresh(SymbolTable &symbols, SymbolID base)
+{
+    string name = symbols.name(base) + "'";
+
+    while (SymbolTable::NONE != symbols.find(name)) name += "'";
+    SymbolID id = symbols.intern(name);
+    symbols.terminal(id, false);
+    this->owners.push_back(this->owners[base]);
+    this->added.resize(symbols.size());
+    this->added[this->owners[base]].push_back(id);
+    this->rewritten.push_back(true);
+    this->rules.resize(symbols.size());
+    this->touch(this->owners[base]);
+    return id;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+RewriteRules::store(CFGProductions &productions) const
+{
+    CFGProductions res;
+    vector<bool> stored(this->rules.size(), false);
+
+    for (size_t p = 0; p < productions.size(); ++p) {
+        SymbolID lhs = productions.lhs(p);
+        if (!this->rewritten[lhs]) {
+            res.push_back(lhs, productions.rhsBegin(p), productions.rhsEnd(p),
+                          productions.origin(p));
+            continue;
+        }
+        if (stored[lhs]) continue;
+        stored[lhs] = true;
+        vector<SymbolID> group(1, lhs);
+        group.insert(group.end(), this->added[lhs].begin(),
+                     this->added[lhs].end());
+        for (SymbolID id : group) {
+            for (const RewriteRule &rule : this->rules[id]) {
+                const SymbolID *rhs = rule.rhs.data();
+                res.push_back(id, rhs, rhs + rule.rhs.size(), rule.origin);
+            }
+        }
+    }
+    productions = res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* strongly connected components of the graph with an edge from every
+ * non-terminal to the non-terminal its productions start with, if any. returns
+ * the ones with a cycle, which are the left-recursive non-terminals. */
+static vector< vector<SymbolID> >
+leftRecursiveGroups(const RewriteRules &rules)
+{
+    const vector< vector<RewriteRule> > &byLHS = rules.rules;
+    const uint32_t unvisited = UINT32_MAX;
+    vector<uint32_t> index(byLHS.size(), unvisited), low(byLHS.size(), 0);
+    vector<bool> onStack(byLHS.size(), false);
+    vector<SymbolID> stk;
+    /* explicit call stack of non-terminals and their next production */
+    vector< pair<SymbolID, size_t> > calls;
+    vector< vector<SymbolID> > res;
+    uint32_t next = 0;
+
+    auto visit = [&](SymbolID id) {
+        index[id] = low[id] = next++;
+        stk.push_back(id);
+        onStack[id] = true;
+        calls.push_back(make_pair(id, 0));
+    };
+    for (SymbolID root = 0; root < byLHS.size(); ++root) {
+        if (byLHS[root].empty() || unvisited != index[root]) continue;
+        visit(root);
+        while (!calls.empty()) {
+            SymbolID id = calls.back().first;
+            size_t k = calls.back().second++;
+            if (k < byLHS[id].size()) {
+                const vector<SymbolID> &rhs = byLHS[id][k].rhs;
+                if (rhs.empty() || byLHS[rhs[0]].empty()) continue;
+                if (unvisited == index[rhs[0]]) visit(rhs[0]);
+                else if (onStack[rhs[0]]) {
+                    low[id] = min(low[id], index[rhs[0]]);
+                }
+                continue;
+            }
+            calls.pop_back();
+            if (!calls.empty()) {
+                SymbolID caller = calls.back().first;
+                low[caller] = min(low[caller], low[id]);
+            }
+            if (low[id] != index[id]) continue;
+            vector<SymbolID> group;
+            SymbolID member;
+            do {
+                member = stk.back(); stk.pop_back();
+                onStack[member] = false;
+                group.push_back(member);
+            } while (member != id);
+            bool cycle = (group.size() > 1);
+            for (const RewriteRule &rule : byLHS[id]) {
+                cycle |= (!rule.rhs.empty() && id == rule.rhs[0]);
+            }
+            if (!cycle) continue;
+            sort(group.begin(), group.end());
+            res.push_back(group);
+        }
+    }
+    return res;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
+/* A --> Aa | b becomes A --> bA', A' --> aA' | epsilon */
 static void
-refreshSymbolTypes(CFGProductions &prods)
+removeDirectLeftRecursion(SymbolTable &symbols,
+                          RewriteRules &rules,
+                          SymbolID id)
+{
+    vector<RewriteRule> recursive, rest;
+
+    for (const RewriteRule &rule : rules.rules[id]) {
+        if (rule.rhs.empty() || id != rule.rhs[0]) rest.push_back(rule);
+        /* A --> A derives nothing new */
+        else if (rule.rhs.size() > 1) {
+            recursive.push_back(rule);
+            recursive.back().rhs.erase(recursive.back().rhs.begin());
+        }
+    }
+    /* non-generating, so clean() gets it */
+    if (rest.empty()) return;
+    if (!recursive.empty()) {
+        SymbolID tail = rules.fresh(symbols, id);
+        for (RewriteRule &rule : rest) rule.rhs.push_back(tail);
+        for (RewriteRule &rule : recursive) rule.rhs.push_back(tail);
+        recursive.push_back(RewriteRule());
+        recursive.back().origin = CFGProductions::NONE;
+        rules.rules[tail] = recursive;
+    }
+    rules.rules[id] = rest;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the usual algorithm, but only over each group of mutually left-recursive
+ * non-terminals: in id order, productions of the i-th that start with an
+ * earlier one get that one's productions substituted in until none do, and
+ * then direct left recursion is removed. substituted productions keep the
+ * origin of the production they replaced. */
+bool
+LeftRecursionRemover::apply(SymbolTable &symbols,
+                            CFGProductions &productions) const
 {
-    set<Symbol> nonTerms;
-    Symbol start = prods.begin()->lhs();
+    RewriteRules rules(symbols, productions);
+    vector< vector<SymbolID> > groups = leftRecursiveGroups(rules);
 
-    for (CFGProduction &p : prods) {
-        p.lhs().terminal(false);
-        p.lhs().start(p.lhs() == start);
-        nonTerms.insert(p.lhs());
+    if (this->verbose) dout << "removing left recursion..." << endl;
+    if (groups.empty()) {
+        if (this->verbose) dout << "  none found" << endl;
+        return false;
     }
-    for (CFGProduction &p : prods) {
-        for (Symbol &s : p.rhs()) {
-            s.terminal(nonTerms.end() == nonTerms.find(s));
-            s.start(s == start);
+    vector<uint32_t> rank(symbols.size(), UINT32_MAX);
+    for (const vector<SymbolID> &group : groups) {
+        if (this->verbose) {
+            string members;
+            for (SymbolID id : group) members += " " + symbols.name(id);
+            dout << " " << members << endl;
         }
+        for (uint32_t i = 0; i < group.size(); ++i) rank[group[i]] = i;
+        for (uint32_t i = 0; i < group.size(); ++i) {
+            SymbolID id = group[i];
+            vector<RewriteRule> res;
+            /* back to front, so that substitutions keep their place */
+            vector<RewriteRule> work(rules.rules[id].rbegin(),
+                                     rules.rules[id].rend());
+            while (!work.empty()) {
+                RewriteRule rule = work.back(); work.pop_back();
+                if (rule.rhs.empty() || rank[rule.rhs[0]] >= i) {
+                    res.push_back(rule);
+                    continue;
+                }
+                const vector<RewriteRule> &subs = rules.rules[rule.rhs[0]];
+                for (auto sub = subs.rbegin(); subs.rend() != sub; ++sub) {
+                    RewriteRule expanded;
+                    expanded.rhs = sub->rhs;
+                    expanded.rhs.insert(expanded.rhs.end(),
+                                        rule.rhs.begin() + 1, rule.rhs.end());
+                    expanded.origin = rule.origin;
+                    work.push_back(expanded);
+                }
+            }
+            rules.rules[id] = res;
+            rules.touch(id);
+            removeDirectLeftRecursion(symbols, rules, id);
+            rank.resize(symbols.size(), UINT32_MAX);
+        }
+        for (SymbolID id : group) rank[id] = UINT32_MAX;
     }
+    rules.store(productions);
+    return true;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-void
-CFG::refresh(void)
+/* A --> abc | abd becomes A --> abA', A' --> c | d, over and over until no two
+ * productions of a non-terminal start alike. duplicates go first. */
+bool
+LeftFactorer::apply(SymbolTable &symbols,
+                    CFGProductions &productions) const
 {
-    refreshSymbolTypes(this->productions);
+    RewriteRules rules(symbols, productions);
+    vector<SymbolID> work;
+    bool changed = false;
+
+    if (this->verbose) dout << "left factoring..." << endl;
+    for (SymbolID id = symbols.size(); id-- > 0;) {
+        if (rules.rules[id].size() > 1) work.push_back(id);
+    }
+    while (!work.empty()) {
+        SymbolID id = work.back(); work.pop_back();
+        vector<RewriteRule> res;
+        for (const RewriteRule &rule : rules.rules[id]) {
+            bool dup = false;
+            for (const RewriteRule &kept : res) dup |= (kept.rhs == rule.rhs);
+            if (!dup) res.push_back(rule);
+        }
+        if (res.size() != rules.rules[id].size()) {
+            rules.touch(id);
+            changed = true;
+        }
+        for (size_t k = 0; k < res.size(); ++k) {
+            if (res[k].rhs.empty()) continue;
+            vector<size_t> alike(1, k);
+            size_t prefix = res[k].rhs.size();
+            for (size_t m = k + 1; m < res.size(); ++m) {
+                const vector<SymbolID> &rhs = res[m].rhs;
+                if (rhs.empty() || rhs[0] != res[k].rhs[0]) continue;
+                size_t n = 1;
+                while (n < prefix && n < rhs.size() &&
+                       rhs[n] == res[k].rhs[n]) ++n;
+                prefix = n;
+                alike.push_back(m);
+            }
+            if (1 == alike.size()) continue;
+            SymbolID tail = rules.fresh(symbols, id);
+            vector<RewriteRule> tails;
+            for (size_t m : alike) {
+                tails.push_back(res[m]);
+                tails.back().rhs.erase(tails.back().rhs.begin(),
+                                       tails.back().rhs.begin() + prefix);
+            }
+            if (this->verbose) {
+                string common;
+                for (size_t n = 0; n < prefix; ++n) {
+                    common += symbols.name(res[k].rhs[n]);
+                }
+                dout << "  " << symbols.name(id) << " --> " << common << "..."
+                     << endl;
+            }
+            res[k].rhs.resize(prefix);
+            res[k].rhs.push_back(tail);
+            res[k].origin = CFGProductions::NONE;
+            for (size_t a = alike.size(); a-- > 1;) {
+                res.erase(res.begin() + alike[a]);
+            }
+            rules.rules[tail] = tails;
+            work.push_back(tail);
+            changed = true;
+        }
+        rules.rules[id] = res;
+    }
+    if (!changed) {
+        if (this->verbose) dout << "  none found" << endl;
+        return false;
+    }
+    rules.store(productions);
+    return true;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-Symbol
-CFG::startSymbol(void) const
+/* ////////////////////////////////////////////////////////////////////////// */
+/* CFG */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+/* ////////////////////////////////////////////////////////////////////////// */
+CFG::CFG(const SymbolTable &symbols,
+         const vector<CFGProduction> &productions,
+         const vector<TokenRule> &tokens)
 {
-    CFGProduction fp = *this->productions.begin();
-    return fp.lhs();
+    this->verbose = false;
+    this->nthreads = 1;
+    this->crunched = false;
+    this->symbolTable = symbols;
+    this->tokenRules = tokens;
+    if (productions.empty()) {
+        string estr = "grammar has no productions. cannot continue.";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    /* add a new, special terminal, $ and new start production */
+    SymbolID newp[2] = {productions.begin()->lhs(), SymbolTable::END};
+    this->productions.push_back(SymbolTable::START, newp, newp + 2);
+    for (const CFGProduction &p : productions) {
+        this->productions.push_back(p);
+    }
+    this->refresh();
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+CFG::refresh(void)
+{
+    SymbolTable &symbols = this->symbolTable;
+
+    for (SymbolID id = 0; id < symbols.size(); ++id) {
+        symbols.terminal(id, true);
+    }
+    for (size_t p = 0; p < this->productions.size(); ++p) {
+        symbols.terminal(this->productions.lhs(p), false);
+    }
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
 CFG::emitState(void) const
 {
+    const SymbolTable &symbols = this->symbolTable;
+
     dout << endl;
-    dout << "start symbol: " << this->startSymbol() << endl;
+    dout << "start symbol: " << symbols.name(this->startSymbol()) << endl;
 
     dout << "non-terminals begin" << endl;
-    emitAllMembers(this->getNonTerminals());
+    emitAllMembers(symbols, this->getNonTerminals());
     dout << "non-terminals end" << endl;
     dout << endl;
 
     dout << "terminals begin" << endl;
-    emitAllMembers(this->getTerminals());
+    emitAllMembers(symbols, this->getTerminals());
     dout << "terminals end" << endl;
     dout << endl;
 
     dout << "productions begin" << endl;
-    emitAllMembers(this->productions);
+    emitAllProductions(symbols, this->productions);
     dout << "productions end" << endl;
     dout << endl;
+
+    if (this->tokenRules.empty()) return;
+    dout << "tokens begin" << endl;
+    for (const TokenRule &r : this->tokenRules) {
+        bool skip = SymbolTable::NONE == r.terminal;
+        dout << "  " << (skip ? "(skip)" : symbols.name(r.terminal)) << " "
+             << r.pattern << endl;
+    }
+    dout << "tokens end" << endl;
+    dout << endl;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 /* this is easy because we know that only non-terminals are going to be on the
- * left-hand side of all of our productions. just iterate over all the
- * productions and stash the left-hand sides. */
-set<Symbol>
+ * left-hand side of all of our productions. */
+vector<SymbolID>
 CFG::getNonTerminals(void) const
 {
-    set<Symbol> nonTerms;
+    vector<SymbolID> nonTerms;
 
-    for (CFGProduction p : this->productions) {
-        if (!p.lhs().terminal()) nonTerms.insert(p.lhs());
-        for (const Symbol &s : p.rhs()) {
-            if (!s.terminal()) nonTerms.insert(s);
-        }
+    for (SymbolID id : occurringSymbols(this->symbolTable, this->productions)) {
+        if (!this->symbolTable.terminal(id)) nonTerms.push_back(id);
     }
     return nonTerms;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-set<Symbol>
+vector<SymbolID>
 CFG::getTerminals(void) const
 {
-    set<Symbol> terms;
+    vector<SymbolID> terms;
 
-    for (CFGProduction p : this->productions) {
-        if (p.lhs().terminal()) terms.insert(p.lhs());
-        for (const Symbol &s : p.rhs()) {
-            if (s.terminal()) terms.insert(s);
-        }
+    for (SymbolID id : occurringSymbols(this->symbolTable, this->productions)) {
+        if (this->symbolTable.terminal(id)) terms.push_back(id);
     }
     return terms;
 }
@@ -491,19 +949,24 @@ CFG::clean(const CFGProductionMarker &marker,
            const CFGProductionEraser &eraser,
            const CFGProductionHygieneAlgo &algo)
 {
+    SymbolMarks marks;
+
     if (this->verbose) {
         dout << __func__ << ": grammar hygiene begin ***" << endl;
     }
     /* start by marking all symbols */
-    marker.mark(this->productions);
+    marker.mark(this->symbolTable, marks);
     /* run the hygiene algo */
-    algo.go(this->productions);
+    algo.go(this->productions, marks);
     /* erase unproductive productions */
-    eraser.erase(this->productions);
+    eraser.erase(this->symbolTable, this->productions, marks);
+    /* production indices moved */
+    this->productionIndex = ProductionIndex();
+    this->crunched = false;
 
     if (this->verbose) {
         dout << __func__ << ": here is the new cfg:" << endl;
-        emitAllMembers(this->productions);
+        emitAllProductions(this->symbolTable, this->productions);
         dout << __func__ << ": grammar hygiene end ***" << endl;
         dout << endl;
     }
@@ -524,6 +987,10 @@ CFG::clean(void)
     UnreachableEraser  rEraser;  rEraser.beVerbose(this->verbose);
     UnreachableHygiene rHygiene; rHygiene.beVerbose(this->verbose);
 
+    ThreadPool pool(this->nthreads);
+    gHygiene.usePool(&pool);
+    rHygiene.usePool(&pool);
+
     /**
      * general algorithm for removing non-generating symbols:
      * mark all terminals
@@ -547,231 +1014,284 @@ CFG::clean(void)
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-void
-CFG::crunch(void)
+static void
+emitOrigins(const SymbolTable &symbols,
+            const CFGProductions &productions,
+            const CFGProductions &originals)
 {
-    this->parseTablePrep();
+    for (size_t p = 0; p < productions.size(); ++p) {
+        uint32_t origin = productions.origin(p);
+        string from = (CFGProductions::NONE == origin) ? "new" :
+                      "from " + originals.str(origin, symbols);
+        dout << "  " << productions.str(p, symbols) << " (" << from << ")"
+             << endl;
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+CFG::transform(const CFGProductionTransform &t)
+{
+    bool first = this->originalProductions.empty();
+
+    if (this->verbose) {
+        dout << __func__ << ": grammar transformation begin ***" << endl;
+    }
+    /* origins index the productions as they were before anything changed */
+    if (first) {
+        this->originalProductions = this->productions;
+        for (size_t p = 0; p < this->productions.size(); ++p) {
+            this->productions.origin(p, static_cast<uint32_t>(p));
+        }
+    }
+    bool changed = t.apply(this->symbolTable, this->productions);
+    if (changed) {
+        this->refresh();
+        /* production indices moved */
+        this->productionIndex = ProductionIndex();
+        this->crunched = false;
+    }
+    else if (first) this->originalProductions = CFGProductions();
+
+    if (this->verbose) {
+        if (changed) {
+            dout << __func__ << ": here is the new cfg:" << endl;
+            emitOrigins(this->symbolTable, this->productions,
+                        this->originalProductions);
+        }
+        dout << __func__ << ": grammar transformation end ***" << endl;
+        dout << endl;
+    }
+    return changed;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+CFG::transform(void)
+{
+    /* left recursion first. removing it never adds a shared prefix that
+     * factoring wouldn't then take care of. */
+    LeftRecursionRemover lrRemover; lrRemover.beVerbose(this->verbose);
+    LeftFactorer         factorer;  factorer.beVerbose(this->verbose);
+
+    bool changed = this->transform(lrRemover);
+    changed = this->transform(factorer) || changed;
+    /* substitution can leave non-terminals that nothing reaches anymore */
+    if (changed) this->clean();
+    return changed;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-CFG::parseTablePrep(void)
+CFG::crunch(void)
 {
-    /* the order of this matters. */
-    this->computeNullable();
-    this->computeFirstSets();
-    this->computeFollowSets();
+    this->parseTablePrep();
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-CFG::computeNullable(void)
+CFG::parseTablePrep(void)
 {
-    NullableMarker marker; marker.beVerbose(this->verbose);
-    bool hadUpdate;
+    ThreadPool pool(this->nthreads);
 
-    if (this->verbose) {
-        dout << __func__ << ": nullable fixed-point begin ***" << endl;
-    }
-    /* init symbol markers for nullable calculation */
-    marker.mark(this->productions);
-    /* start the fixed-point calculation */
-    do {
-        hadUpdate = false;
-        for (CFGProduction &p : this->productions) {
-            if (p.rhsMarked() && !p.lhs().marked()) {
-                p.lhs().nullable(true);
-                propagateMark(this->productions, p.lhs().sym());
-                propagateNullable(this->productions, p.lhs().sym());
-                hadUpdate = true;
-            }
-        }
-    } while (hadUpdate);
+    this->refresh();
+    this->grammarAnalysis.init(this->symbolTable, this->productions);
+    /* the order of this matters. */
+    this->computeNullable();
+    this->computeFirstSets(pool);
+    this->computeFollowSets(pool);
+    this->crunched = true;
 
     if (this->verbose) {
-        emitNullables(this->productions);
-        dout << __func__ << ": nullable fixed-point end ***" << endl;
+        dout << __func__ << ": dependency graph had "
+             << this->grammarAnalysis.edges() << " edges and "
+             << this->grammarAnalysis.edgeVisits() << " edge visits ***"
+             << endl;
         dout << endl;
     }
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-void
-CFG::refreshFirstSets(void)
+vector<SymbolID>
+CFG::recrunch(void)
 {
-    for (CFGProduction &p : this->productions) {
-        for (Symbol &sym : p.rhs()) {
-            /* add myself to my firsts if not epsilon 8-| */
-            if (sym.terminal() && !sym.epsilon()) {
-                sym.firsts().insert(sym);
-            }
+    if (!this->crunched) return vector<SymbolID>();
+    this->parseTablePrep();
+    return this->grammarAnalysis.nonTerminals();
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a symbol is a non-terminal exactly when it has productions. edits that keep
+ * every symbol's kind are patched into the analysis. the others change the
+ * shape of the whole thing, so they start over. */
+vector<SymbolID>
+CFG::addProduction(const CFGProduction &prod)
+{
+    SymbolTable &symbols = this->symbolTable;
+    ProductionIndex &index = this->productionIndex;
+    GrammarAnalysis &analysis = this->grammarAnalysis;
+    SymbolID lhs = prod.lhs();
+    bool reshape = false;
+
+    if (SymbolTable::START == lhs || lhs >= symbols.size()) {
+        string estr = "cannot add a production for " + symbols.name(lhs);
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    for (SymbolID id : prod.rhs()) {
+        if (id >= symbols.size() || SymbolTable::START == id) {
+            string estr = "cannot add a production using " + symbols.name(id);
+            throw DialectException(DIALECT_WHERE, estr);
         }
     }
+    if (index.empty()) index.build(symbols.size(), this->productions);
+    /* new right-hand side symbols are terminals unless they are lhs */
+    for (SymbolID id : prod.rhs()) {
+        if (!index.occurs(id)) symbols.terminal(id, id != lhs);
+    }
+    symbols.terminal(lhs, false);
+    /* the analysis already knows every symbol it has seen as one kind */
+    reshape = (GrammarAnalysis::NONE != analysis.terminalIndex(lhs));
+    for (SymbolID id : prod.rhs()) {
+        reshape |= symbols.terminal(id) ?
+                   GrammarAnalysis::NONE != analysis.nonTerminalIndex(id) :
+                   GrammarAnalysis::NONE != analysis.terminalIndex(id);
+    }
+    this->productions.push_back(prod);
+    index.add(this->productions, this->productions.size() - 1);
+    if (!this->crunched) return vector<SymbolID>();
+    if (reshape) return this->recrunch();
+    analysis.addSymbol(lhs, false);
+    for (SymbolID id : prod.rhs()) analysis.addSymbol(id, symbols.terminal(id));
+    return analysis.update(this->productions, index,
+                           vector<SymbolID>(1, lhs), prod.rhs());
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static void
-emitFirstSets(const CFGProductions &prods)
+vector<SymbolID>
+CFG::removeProduction(size_t p)
 {
-    set<Symbol> lhsSet;
-    for (const CFGProduction &p : prods) {
-        lhsSet.insert(const_cast<CFGProduction &>(p).lhs());
-        auto rhs = const_cast<CFGProduction &>(p).rhs();
-        lhsSet.insert(rhs.begin(), rhs.end());
+    SymbolTable &symbols = this->symbolTable;
+    ProductionIndex &index = this->productionIndex;
+    size_t last = this->productions.size() - 1;
+
+    /* the augmented start production always stays at the front */
+    if (0 == p || p > last) {
+        string estr = "cannot remove production " + to_string(p);
+        throw DialectException(DIALECT_WHERE, estr);
     }
-    for (const Symbol &sym : lhsSet) {
-        dout << "FIRST(" << sym << ") = ";
-        emitAllMembers(const_cast<Symbol &>(sym).firsts(), false);
+    if (index.empty()) index.build(symbols.size(), this->productions);
+    SymbolID lhs = this->productions.lhs(p);
+    SymbolID moved = this->productions.lhs(last);
+    vector<SymbolID> rhs(this->productions.rhsBegin(p),
+                         this->productions.rhsEnd(p));
+    index.remove(this->productions, p);
+    if (p != last) index.move(this->productions, last, p);
+    this->productions.swapRemove(p);
+    /* lhs is either gone or a terminal now */
+    if (index.byLHS(lhs).empty()) {
+        symbols.terminal(lhs, true);
+        return this->recrunch();
     }
+    if (!this->crunched) return vector<SymbolID>();
+    vector<SymbolID> rows = this->grammarAnalysis.update(
+        this->productions, index, vector<SymbolID>(1, lhs), rhs
+    );
+    /* moved's table row refers to it by index */
+    if (p != last && rows.end() == find(rows.begin(), rows.end(), moved)) {
+        rows.push_back(moved);
+    }
+    return rows;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static set<Symbol>
-getAlphaUBeta(const vector<Symbol> &in)
+static void
+emitNullables(const SymbolTable &symbols,
+              const GrammarAnalysis &analysis)
 {
-    vector<Symbol> cin = in;
-    set<Symbol> aub;
-    vector<Symbol>::iterator s = cin.begin();
+    vector<SymbolID> nulls;
 
-    /* alpha's firsts are always going to be in the set */
-    aub.insert(s->firsts().begin(), s->firsts().end());
-    ++s;
-    /* now figure out FIRST(beta) */
-    while (cin.end() != s) {
-        aub.insert(s->firsts().begin(), s->firsts().end());
-        if (!s->nullable()) break;
-        else ++s;
+    for (SymbolID id : analysis.nonTerminals()) {
+        if (analysis.nullable(id)) nulls.push_back(id);
+    }
+    if (0 != nulls.size()) {
+        dout << "here are the nullable non-terminals: ";
+        emitAllMembers(symbols, nulls, false);
+    }
+    else {
+        dout << "did not find nullable non-terminals..." << endl;
     }
-    return aub;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-CFG::computeFirstSets(void)
+CFG::computeNullable(void)
 {
-    size_t nelems = 0;
-    bool hadUpdate;
-
-    if (this->verbose) dout << __func__ << ": fixed-point begin ***" << endl;
+    if (this->verbose) {
+        dout << __func__ << ": nullable fixed-point begin ***" << endl;
+    }
 
-    this->refreshFirstSets();
-    /* start the fixed-point calculation */
-    do {
-        hadUpdate = false;
-        for (CFGProduction &p : this->productions) {
-            nelems = p.lhs().firsts().size();
-            Symbol alpha = *p.rhs().begin();
-            if (alpha.terminal() || !alpha.nullable()) {
-                p.lhs().firsts().insert(alpha.firsts().begin(),
-                                        alpha.firsts().end());
-            }
-            else {
-                set<Symbol> aub = getAlphaUBeta(p.rhs());
-                p.lhs().firsts().insert(aub.begin(), aub.end());
-            }
-            propagateFirsts(this->productions, p.lhs().sym(), p.lhs().firsts());
-            if (nelems != p.lhs().firsts().size()) hadUpdate = true;
-        }
-    } while (hadUpdate);
+    this->grammarAnalysis.computeNullable(this->productions);
 
     if (this->verbose) {
-        dout << __func__ << ": here are the first sets:" << endl;
-        emitFirstSets(this->productions);
-        dout << __func__ << ": fixed-point end ***" << endl;
+        emitNullables(this->symbolTable, this->grammarAnalysis);
+        dout << __func__ << ": nullable fixed-point end ***" << endl;
         dout << endl;
     }
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-void
-CFG::followsetPrep(void)
-{
-    this->refresh();
-    this->refreshFirstSets();
-}
-
-/* ////////////////////////////////////////////////////////////////////////// */
-static bool
-nullableFromHere(const vector<Symbol> &l, vector<Symbol>::iterator i)
+static void
+emitFirstSets(const SymbolTable &symbols,
+              const CFGProductions &prods,
+              const GrammarAnalysis &analysis)
 {
-    for (; l.end() != i; ++i) {
-        if (!i->nullable()) return false;
+    for (SymbolID id : occurringSymbols(symbols, prods)) {
+        dout << "FIRST(" << symbols.name(id) << ") = ";
+        emitAllMembers(symbols, analysis.firsts(id), false);
     }
-    return true;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static set<Symbol>
-firstOfBeta(const vector<Symbol> &in)
+void
+CFG::computeFirstSets(ThreadPool &pool)
 {
-    vector<Symbol> cin = in;
-    vector<Symbol>::iterator i = cin.begin();
-    /* first of beta set */
-    set<Symbol> fob;
+    if (this->verbose) dout << __func__ << ": fixed-point begin ***" << endl;
 
-    /* now figure out FIRST(beta) */
-    while (cin.end() != i) {
-        fob.insert(i->firsts().begin(), i->firsts().end());
-        if (!i->nullable()) break;
-        else ++i;
+    this->grammarAnalysis.computeFirstSets(this->productions, &pool);
+
+    if (this->verbose) {
+        dout << __func__ << ": here are the first sets:" << endl;
+        emitFirstSets(this->symbolTable, this->productions,
+                      this->grammarAnalysis);
+        dout << __func__ << ": fixed-point end ***" << endl;
+        dout << endl;
     }
-    return fob;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static bool
-followFPO(CFGProductions &productions)
+static void
+emitFollowSets(const SymbolTable &symbols,
+               const CFGProductions &prods,
+               const GrammarAnalysis &analysis)
 {
-    size_t nelems = 0;
-    bool hadUpdate = false;
-
-    for (CFGProduction &p : productions) {
-        auto rhss = p.rhs().begin();
-        while (p.rhs().end() != rhss) {
-            if (!rhss->terminal()) {
-                nelems = rhss->follows().size();
-                /* for the case where beta is empty */
-                vector<Symbol> slice(rhss, p.rhs().end());
-                if (lastElem(slice)) {
-                    rhss->follows().insert(p.lhs().follows().begin(),
-                                           p.lhs().follows().end());
-                }
-                else {
-                    /* safe because rhss not last element */
-                    ++rhss;
-                    vector<Symbol> slice(rhss, p.rhs().end());
-                    auto fob = firstOfBeta(slice);
-                    if (nullableFromHere(p.rhs(), rhss)) {
-                        --rhss;
-                        rhss->follows().insert(p.lhs().follows().begin(),
-                                               p.lhs().follows().end());
-                        ++rhss;
-                    }
-                    --rhss;
-                    rhss->follows().insert(fob.begin(), fob.end());
-                }
-                if (nelems != rhss->follows().size()) hadUpdate = true;
-                propagateFollows(productions, *rhss);
-            }
-            ++rhss;
-        }
+    for (SymbolID id : occurringSymbols(symbols, prods)) {
+        dout << "FOLLOW(" << symbols.name(id) << ") = ";
+        emitAllMembers(symbols, analysis.follows(id), false);
     }
-    return hadUpdate;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-CFG::computeFollowSets(void)
+CFG::computeFollowSets(ThreadPool &pool)
 {
     if (this->verbose) dout << __func__ << ": begin ***" << endl;
 
-    this->followsetPrep();
-    /* run the fixed-point algorithm until there are no changes */
-    while (followFPO(this->productions));
+    this->grammarAnalysis.computeFollowSets(this->productions, &pool);
 
     if (this->verbose) {
         dout << __func__ << ": here are the follow sets:" << endl;
-        emitFollowSets(this->productions);
+        emitFollowSets(this->symbolTable, this->productions,
+                       this->grammarAnalysis);
         dout << __func__ << ": end ***" << endl;
         dout << endl;
     }
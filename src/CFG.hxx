@@ -22,166 +22,166 @@
 #include "config.h"
 #endif
 
+#include "Symbol.hxx"
+#include "GrammarAnalysis.hxx"
+#include "ThreadPool.hxx"
+#include "Lexer.hxx"
+
 #include <iostream>
 #include <string>
 #include <vector>
-#include <set>
+
+#include <stdint.h>
 
 /* ////////////////////////////////////////////////////////////////////////// */
-/* symbol class */
+/* context-free grammar production class */
 /* ////////////////////////////////////////////////////////////////////////// */
-class Symbol {
+/* a single, unpacked production. an empty right-hand side is epsilon. */
+class CFGProduction {
 private:
-    /* general marker for a symbol */
-    bool marker;
-    /* string representation of the grammar symbol */
-    std::string symbol;
-    /* flag indicating whether or not this symbol is a terminal symbol */
-    bool _terminal;
-    /* flag indicating whether or not this symbol is the start symbol */
-    bool _start;
-    /* flag indicating whether or not this symbol is epsilon */
-    bool _epsilon;
-    /* flag indicating whether or not this symbol is nullable */
-    bool _nullable;
-    /* first set for symbol */
-    std::set<Symbol> firstSet;
-    /* follow set for symbol */
-    std::set<Symbol> followSet;
+    /* left-hand side of production */
+    SymbolID leftHandSide;
+    /* right-hand side of production */
+    std::vector<SymbolID> rightHandSide;
 
 public:
-    /* nothing */
-    static const std::string DEAD;
-    /* epsilon string representation */
-    static const std::string EPSILON;
-    /* real start symbol string */
-    static const std::string START;
-    /* special terminal symbol string */
-    static const std::string END;
-    /* all "valid" symbols will be exactly one character in length */
-    Symbol(void) : marker(false),
-                   symbol(Symbol::DEAD),
-                   _terminal(false),
-                   _start(false),
-                   _epsilon(false),
-                   _nullable(false) { ; }
-
-    Symbol(const std::string &sym,
-           bool marked = false,
-           bool terminal = true,
-           bool start = false) : marker(marked),
-                                 symbol(sym),
-                                 _terminal(terminal),
-                                 _start(start),
-                                 _epsilon(Symbol::EPSILON == symbol),
-                                 _nullable(false) { ; }
-
-    ~Symbol(void) { ; }
-
-    std::string sym(void) const { return this->symbol; }
-
-    bool marked(void) const { return this->marker; }
-
-    void mark(bool m = true) { this->marker = m; }
-
-    bool terminal(void) const { return this->_terminal; }
-
-    void terminal(bool is) { this->_terminal = is; }
-
-    void start(bool is) { this->_start = is; }
-
-    bool start(void) const { return this->_start; }
-
-    bool epsilon(void) const { return this->_epsilon; }
-
-    bool nullable(void) const { return this->_nullable; }
-
-    void nullable(bool n) { this->_nullable = n; }
-
-    std::set<Symbol> &firsts(void) { return this->firstSet; }
-
-    std::set<Symbol> &follows(void) { return this->followSet; }
-    /* == */
-    friend bool operator==(const Symbol &s1,
-                           const Symbol &s2);
-    /* != */
-    friend bool operator!=(const Symbol &s1,
-                           const Symbol &s2);
-    /* < */
-    friend bool operator<(const Symbol &s1,
-                          const Symbol &s2);
-    /* << */
-    friend std::ostream &operator<<(std::ostream &out,
-                                    const Symbol &symbol);
+    CFGProduction(void) : leftHandSide(SymbolTable::NONE) { ; }
+
+    CFGProduction(SymbolID lhs,
+                  const std::vector<SymbolID> &rhs) : leftHandSide(lhs),
+                                                      rightHandSide(rhs) { ; }
+
+    CFGProduction(SymbolTable &symbols,
+                  const std::string &lhs,
+                  const std::string &rhs = "");
+
+    ~CFGProduction(void) { /* nothing to do */; }
+
+    SymbolID lhs(void) const { return this->leftHandSide; }
+
+    const std::vector<SymbolID> &rhs(void) const {
+        return this->rightHandSide;
+    }
 };
 
 /* ////////////////////////////////////////////////////////////////////////// */
-/* context-free grammar production class */
+/* production store class */
 /* ////////////////////////////////////////////////////////////////////////// */
-class CFGProduction {
+/* compressed sparse row layout: the right-hand sides of all productions live
+ * back-to-back in one array and production p owns rhss[begins[p], ends[p]).
+ * removals may leave holes in rhss that nobody owns until the next compact().
+ */
+class CFGProductions {
 private:
-    /* left-hand side of production */
-    Symbol leftHandSide;
-    /* right-hand side of production */
-    std::vector<Symbol> rightHandSide;
+    /* left-hand side of each production */
+    std::vector<SymbolID> lhss;
+    /* start of each production's right-hand side in rhss */
+    std::vector<uint32_t> begins;
+    /* end of each production's right-hand side in rhss */
+    std::vector<uint32_t> ends;
+    /* all right-hand sides */
+    std::vector<SymbolID> rhss;
+    /* what each production was rewritten from. see origin(). */
+    std::vector<uint32_t> origins;
+    /* number of rhss entries in holes */
+    size_t holes;
 
 public:
-    CFGProduction(void) { /* nothing to do */; }
+    /* no origin */
+    static const uint32_t NONE;
 
-    CFGProduction(const std::string &lhs,
-                  const std::string &rhs = Symbol::EPSILON);
+    CFGProductions(void) : holes(0) { ; }
 
-    ~CFGProduction(void) { /* nothing to do */; }
+    ~CFGProductions(void) { ; }
+
+    size_t size(void) const { return this->lhss.size(); }
+
+    bool empty(void) const { return this->lhss.empty(); }
+
+    SymbolID lhs(size_t p) const { return this->lhss[p]; }
+
+    const SymbolID *rhsBegin(size_t p) const {
+        return this->rhss.data() + this->begins[p];
+    }
 
-    Symbol &lhs(void) { return this->leftHandSide; }
+    const SymbolID *rhsEnd(size_t p) const {
+        return this->rhss.data() + this->ends[p];
+    }
 
-    Symbol clhs(void) const { return this->leftHandSide; }
+    size_t rhsLength(size_t p) const {
+        return this->ends[p] - this->begins[p];
+    }
 
-    std::vector<Symbol> &rhs(void) { return this->rightHandSide; }
+    /* index of the production of CFG::originals() that p was rewritten from.
+     * NONE for productions none of them accounts for. */
+    uint32_t origin(size_t p) const { return this->origins[p]; }
 
-    std::vector<Symbol> crhs(void) const { return this->rightHandSide; }
+    void origin(size_t p, uint32_t o) { this->origins[p] = o; }
 
-    bool rhsMarked(void) const;
+    void push_back(SymbolID lhs,
+                   const SymbolID *rhsb,
+                   const SymbolID *rhse,
+                   uint32_t origin = NONE);
 
-    friend std::ostream &operator<<(std::ostream &out,
-                                    const CFGProduction &production);
+    void push_back(const CFGProduction &p);
 
+    CFGProduction at(size_t p) const;
+
+    /* keeps only those productions flagged in keep in one pass */
+    void compact(const std::vector<bool> &keep);
+
+    /* removes production p in constant time by moving the last production
+     * into its slot */
+    void swapRemove(size_t p);
+
+    std::string str(size_t p, const SymbolTable &symbols) const;
 };
-/* convenience typedefs */
-typedef std::vector<CFGProduction> CFGProductions;
 
 /* ////////////////////////////////////////////////////////////////////////// */
 /* production hygiene marker, eraser, and algorithm classes */
 /* ////////////////////////////////////////////////////////////////////////// */
+/* per-symbol marks, indexed by SymbolID */
+typedef std::vector<bool> SymbolMarks;
+
+bool rhsMarked(const CFGProductions &productions,
+               size_t p,
+               const SymbolMarks &marks);
 
 /* ////////////////////////////////////////////////////////////////////////// */
 class CFGProductionMarker {
 protected:
     bool verbose;
 public:
-    virtual void mark(CFGProductions &productions) const = 0;
+    CFGProductionMarker(void) : verbose(false) { ; }
+
+    virtual void mark(const SymbolTable &symbols,
+                      SymbolMarks &marks) const = 0;
 
     void beVerbose(bool v = true) { this->verbose = v; }
 };
 
 class GeneratingMarker : public CFGProductionMarker {
 public:
-    virtual void mark(CFGProductions &productions) const;
+    virtual void mark(const SymbolTable &symbols,
+                      SymbolMarks &marks) const;
 };
 
 class ReachabilityMarker : public CFGProductionMarker {
 public:
-    virtual void mark(CFGProductions &productions) const;
+    virtual void mark(const SymbolTable &symbols,
+                      SymbolMarks &marks) const;
 };
 
 class NullableMarker : public CFGProductionMarker {
 public:
-    virtual void mark(CFGProductions &productions) const;
+    virtual void mark(const SymbolTable &symbols,
+                      SymbolMarks &marks) const;
 };
 
 class FollowSetMarker : public CFGProductionMarker {
 public:
-    virtual void mark(CFGProductions &productions) const;
+    virtual void mark(const SymbolTable &symbols,
+                      SymbolMarks &marks) const;
 };
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -189,39 +189,89 @@ class CFGProductionEraser {
 protected:
     bool verbose;
 public:
-    virtual void erase(CFGProductions &productions) const = 0;
+    CFGProductionEraser(void) : verbose(false) { ; }
+
+    virtual void erase(const SymbolTable &symbols,
+                       CFGProductions &productions,
+                       const SymbolMarks &marks) const = 0;
 
     void beVerbose(bool v = true) { this->verbose = v; }
 };
 
 class NonGeneratingEraser : public CFGProductionEraser {
 public:
-    virtual void erase(CFGProductions &productions) const;
+    virtual void erase(const SymbolTable &symbols,
+                       CFGProductions &productions,
+                       const SymbolMarks &marks) const;
 };
 
 class UnreachableEraser : public CFGProductionEraser {
 public:
-    virtual void erase(CFGProductions &productions) const;
+    virtual void erase(const SymbolTable &symbols,
+                       CFGProductions &productions,
+                       const SymbolMarks &marks) const;
 };
 
 /* ////////////////////////////////////////////////////////////////////////// */
 class CFGProductionHygieneAlgo {
 protected:
     bool verbose;
+    /* when set, marking is spread across this pool */
+    ThreadPool *pool;
 public:
-    virtual void go(CFGProductions &productions) const = 0;
+    CFGProductionHygieneAlgo(void) : verbose(false), pool(NULL) { ; }
+
+    virtual void go(const CFGProductions &productions,
+                    SymbolMarks &marks) const = 0;
 
     void beVerbose(bool v = true) { this->verbose = v; }
+
+    void usePool(ThreadPool *p) { this->pool = p; }
 };
 
 class NonGeneratingHygiene : public CFGProductionHygieneAlgo {
 public:
-    virtual void go(CFGProductions &productions) const;
+    virtual void go(const CFGProductions &productions,
+                    SymbolMarks &marks) const;
 };
 
 class UnreachableHygiene : public CFGProductionHygieneAlgo {
 public:
-    virtual void go(CFGProductions &productions) const;
+    virtual void go(const CFGProductions &productions,
+                    SymbolMarks &marks) const;
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* production transformation classes */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* rewrite productions into an equivalent grammar. every production written
+ * keeps the origin of the one it was rewritten from. */
+class CFGProductionTransform {
+protected:
+    bool verbose;
+public:
+    CFGProductionTransform(void) : verbose(false) { ; }
+
+    /* returns whether or not productions changed */
+    virtual bool apply(SymbolTable &symbols,
+                       CFGProductions &productions) const = 0;
+
+    void beVerbose(bool v = true) { this->verbose = v; }
+};
+
+/* direct and indirect left recursion through leftmost symbols. left recursion
+ * hidden behind nullable symbols is left alone. */
+class LeftRecursionRemover : public CFGProductionTransform {
+public:
+    virtual bool apply(SymbolTable &symbols,
+                       CFGProductions &productions) const;
+};
+
+/* moves prefixes a non-terminal's productions share into new non-terminals */
+class LeftFactorer : public CFGProductionTransform {
+public:
+    virtual bool apply(SymbolTable &symbols,
+                       CFGProductions &productions) const;
 };
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -231,45 +281,87 @@ class CFG {
 private:
     /* flag indicating whether or not to emit debug output to stdout */
     bool verbose;
+    /* number of threads clean() and crunch() may use */
+    size_t nthreads;
+    /* grammar symbols */
+    SymbolTable symbolTable;
     /* grammar productions */
     CFGProductions productions;
+    /* the terminals spelled by patterns, in priority order */
+    std::vector<TokenRule> tokenRules;
+    /* nullable, first sets, and follow sets */
+    GrammarAnalysis grammarAnalysis;
+    /* whether or not grammarAnalysis matches productions */
+    bool crunched;
+    /* productions by symbol. built by the first edit. */
+    ProductionIndex productionIndex;
+    /* productions before the first transformation that changed them */
+    CFGProductions originalProductions;
+    /* re-crunches everything after an edit that changed some symbol's kind */
+    std::vector<SymbolID> recrunch(void);
     /* refresh some internal state */
     void refresh(void);
     /* compute nullable set */
     void computeNullable(void);
-    /* first step when computing first sets */
-    void refreshFirstSets(void);
     /* compute first sets */
-    void computeFirstSets(void);
-    /* performs prep work for computeFollowSets */
-    void followsetPrep(void);
+    void computeFirstSets(ThreadPool &pool);
     /* compute follow sets */
-    void computeFollowSets(void);
+    void computeFollowSets(ThreadPool &pool);
     /* performs prep work for parse table creation */
     void parseTablePrep(void);
 
 public:
-    CFG(void) { this->verbose = false; }
+    CFG(void) : verbose(false), nthreads(1), crunched(false) { ; }
 
-    CFG(const CFGProductions &productions);
+    CFG(const SymbolTable &symbols,
+        const std::vector<CFGProduction> &productions,
+        const std::vector<TokenRule> &tokens = std::vector<TokenRule>());
 
     ~CFG(void) { ; }
 
-    std::set<Symbol> getNonTerminals(void) const;
+    std::vector<SymbolID> getNonTerminals(void) const;
 
-    std::set<Symbol> getTerminals(void) const;
+    std::vector<SymbolID> getTerminals(void) const;
 
-    Symbol startSymbol(void) const;
+    SymbolID startSymbol(void) const { return SymbolTable::START; }
 
     void beVerbose(bool v = true) { this->verbose = v; }
 
+    void threads(size_t n) { this->nthreads = (0 == n ? 1 : n); }
+
     void emitState(void) const;
 
     void crunch(void);
 
-    static CFGProductions refresh(const CFGProductions &prods);
+    const SymbolTable &symbols(void) const { return this->symbolTable; }
+
+    const CFGProductions &prods(void) const { return this->productions; }
+
+    /* empty unless input is lexed into tokens */
+    const std::vector<TokenRule> &tokens(void) const {
+        return this->tokenRules;
+    }
+
+    const GrammarAnalysis &analysis(void) const {
+        return this->grammarAnalysis;
+    }
+
+    const ProductionIndex &prodIndex(void) const {
+        return this->productionIndex;
+    }
 
-    CFGProductions &prods(void) { return this->productions; }
+    /* interns name so that added productions can use it */
+    SymbolID intern(const std::string &name) {
+        return this->symbolTable.intern(name);
+    }
+
+    /* incremental edits. once crunched, both keep the analysis current by
+     * redoing only what the edit could have changed and return the
+     * non-terminals whose LL(1) table rows may have changed. */
+    std::vector<SymbolID> addProduction(const CFGProduction &p);
+
+    /* the last production takes over index p */
+    std::vector<SymbolID> removeProduction(size_t p);
 
     /* cleans cfg based on marker, eraser, and algo behavior */
     void clean(const CFGProductionMarker &marker,
@@ -277,6 +369,28 @@ public:
                const CFGProductionHygieneAlgo &algo);
 
     void clean(void);
+
+    /* rewrites productions with t. returns whether or not anything changed. */
+    bool transform(const CFGProductionTransform &t);
+
+    /* removes left recursion and left factors so that more grammars are
+     * strong LL(1). */
+    bool transform(void);
+
+    /* whether or not transform() changed anything */
+    bool rewritten(void) const { return !this->originalProductions.empty(); }
+
+    /* the productions origins index */
+    const CFGProductions &originals(void) const {
+        return this->originalProductions.empty() ? this->productions :
+                                                    this->originalProductions;
+    }
+
+    /* index of the production of originals() that p was rewritten from */
+    uint32_t origin(size_t p) const {
+        return this->originalProductions.empty() ? static_cast<uint32_t>(p) :
+                                                    this->productions.origin(p);
+    }
 };
 
 #endif
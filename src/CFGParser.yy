@@ -35,8 +35,12 @@ extern "C" FILE *yyin;
 CFG *contextFreeGrammar = NULL;
 /* input line number used for nice error messages */
 int lineNo = 1;
+/* symbols seen so far */
+SymbolTable cfgSymbols;
 /* list of productions */
 std::vector<CFGProduction> cfgProductions;
+/* token rules, in the order they were given */
+std::vector<TokenRule> cfgTokens;
 
 /* ////////////////////////////////////////////////////////////////////////// */
 static int
@@ -51,21 +55,57 @@ nonTermOkay(const std::string &nonTerm)
     return true;
 }
 
+/* ////////////////////////////////////////////////////////////////////////// */
+/* trailing blanks are not part of a pattern */
+static bool
+patternOkay(std::string &pattern)
+{
+    std::string why;
+
+    pattern.erase(pattern.find_last_not_of(" \t") + 1);
+    if (!TokenRule::valid(pattern, why)) {
+        std::cerr << "bad pattern " << pattern << ": " << why
+                  << ". please fix error at line: " << lineNo << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static bool
+tokenOkay(const std::string &name)
+{
+    if (3 > name.length() || '<' != name[0] ||
+        name.length() - 1 != name.find_first_of("<>", 1)) {
+        std::cerr << "token names are spelled <name>. please fix error at "
+                  << "line: " << lineNo << std::endl;
+        return false;
+    }
+    if (SymbolTable::NONE != cfgSymbols.find(name)) {
+        std::cerr << "token " << name << " is declared twice or after it was "
+                  << "used. please fix error at line: " << lineNo << std::endl;
+        return false;
+    }
+    return true;
+}
+
 %}
 
 %union {
     std::string *str;
 }
 
-%token <str> TERM
+%token <str> TERM PATTERN
 %token <contextFreeGrammar>
-%token NEWLINE ARROW COMMENT
+%token NEWLINE ARROW COMMENT TOKEN SKIP
 
 %start cfg
 
 %%
 
-cfg : productions { contextFreeGrammar = new CFG(cfgProductions); }
+cfg : productions {
+          contextFreeGrammar = new CFG(cfgSymbols, cfgProductions, cfgTokens);
+      }
 ;
 
 productions : /* empty */
@@ -75,12 +115,13 @@ productions : /* empty */
 production : NEWLINE { lineNo++; }
            | COMMENT { lineNo++; }
            | prule   { lineNo++; }
+           | trule   { lineNo++; }
 
 prule : TERM ARROW TERM NEWLINE {
             if (!nonTermOkay(*$1)) {
                 return 1;
             }
-            cfgProductions.push_back(CFGProduction(*$1, *$3));
+            cfgProductions.push_back(CFGProduction(cfgSymbols, *$1, *$3));
             delete $1;
             delete $3;
         }
@@ -88,11 +129,28 @@ prule : TERM ARROW TERM NEWLINE {
             if (!nonTermOkay(*$1)) {
                 return 1;
             }
-            cfgProductions.push_back(CFGProduction(*$1));
+            cfgProductions.push_back(CFGProduction(cfgSymbols, *$1));
             delete $1;
         }
 ;
 
+trule : TOKEN TERM PATTERN NEWLINE {
+            if (!tokenOkay(*$2) || !patternOkay(*$3)) {
+                return 1;
+            }
+            cfgTokens.push_back(TokenRule(cfgSymbols.intern(*$2), *$3));
+            delete $2;
+            delete $3;
+        }
+      | SKIP PATTERN NEWLINE {
+            if (!patternOkay(*$2)) {
+                return 1;
+            }
+            cfgTokens.push_back(TokenRule(SymbolTable::NONE, *$2));
+            delete $2;
+        }
+;
+
 %%
 
 /* ////////////////////////////////////////////////////////////////////////// */
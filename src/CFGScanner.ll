@@ -42,8 +42,29 @@ ASCII [\45-\176]
 
 WS [ \t]
 
+/* token rule lines: %token <name> pattern and %skip pattern. the pattern is
+ * the rest of the line. */
+%x TOKNAME TOKPAT
+
 %%
 
+^"%token" { BEGIN(TOKNAME); return TOKEN; }
+
+^"%skip" { BEGIN(TOKPAT); return SKIP; }
+
+<TOKNAME,TOKPAT>{WS}+ { ; }
+
+<TOKNAME>{ASCII}+ { SAVE_TOKEN; BEGIN(TOKPAT); return TERM; }
+
+<TOKPAT>[^ \t\n][^\n]* { SAVE_TOKEN; return PATTERN; }
+
+<TOKNAME,TOKPAT>"\n" { BEGIN(INITIAL); return NEWLINE; }
+
+<TOKNAME>. { std::cerr << "invalid token name encountered during CFG scan... "
+                       << "bye!" << std::endl;
+             yyterminate();
+           }
+
 {WS}+ { ; }
 
 "\n" { return NEWLINE; }
@@ -0,0 +1,186 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CorpusValidator.hxx"
+#include "DialectException.hxx"
+#include "LL1Parser.hxx"
+#include "ThreadPool.hxx"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* CorpusValidator */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* reads path into input the way UserInputReader does: newlines only separate
+ * lines, unless the image has a lexer, which gets all of it at once. bytes is
+ * scratch. returns false and why if path can't be read. */
+static bool
+readInput(const string &path,
+          const GrammarImage &image,
+          vector<char> &bytes,
+          vector<SymbolID> &input,
+          string &why)
+{
+    struct stat sb;
+    int fd = open(path.c_str(), O_RDONLY);
+
+    input.clear();
+    if (-1 == fd || -1 == fstat(fd, &sb)) {
+        why = strerror(errno);
+        if (-1 != fd) close(fd);
+        return false;
+    }
+    const Lexer &lexer = image.lexer();
+    const SymbolID *byteTerminals = image.byteTerminals();
+    size_t have = 0;
+    bytes.resize(max(size_t(sb.st_size), size_t(1) << 12));
+    for (;;) {
+        if (!lexer.empty() && bytes.size() == have) {
+            bytes.resize(2 * bytes.size());
+        }
+        char *to = bytes.data() + (lexer.empty() ? 0 : have);
+        ssize_t n = read(fd, to, bytes.size() - (to - bytes.data()));
+        if (-1 == n && EINTR == errno) continue;
+        if (-1 == n) {
+            why = strerror(errno);
+            close(fd);
+            return false;
+        }
+        if (0 == n) break;
+        if (!lexer.empty()) {
+            have += n;
+            continue;
+        }
+        for (ssize_t b = 0; b < n; ++b) {
+            if ('\n' == bytes[b]) continue;
+            input.push_back(byteTerminals[uint8_t(bytes[b])]);
+        }
+    }
+    close(fd);
+    if (!lexer.empty() &&
+        lexer.lex(bytes.data(), bytes.data() + have, input) != have) {
+        input.push_back(SymbolTable::NONE);
+    }
+    return true;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+vector<string>
+CorpusValidator::expand(const string &what)
+{
+    vector<string> res;
+    struct stat sb;
+
+    if (0 == stat(what.c_str(), &sb) && S_ISDIR(sb.st_mode)) {
+        DIR *dir = opendir(what.c_str());
+        if (NULL == dir) return vector<string>(1, what);
+        for (struct dirent *e = readdir(dir); NULL != e; e = readdir(dir)) {
+            string path = what + "/" + e->d_name;
+            if (0 == stat(path.c_str(), &sb) && S_ISREG(sb.st_mode)) {
+                res.push_back(path);
+            }
+        }
+        closedir(dir);
+        sort(res.begin(), res.end());
+        return res;
+    }
+    glob_t g;
+    /* what that matches nothing is what, so its verdict says why */
+    if (0 != glob(what.c_str(), GLOB_NOCHECK, NULL, &g)) {
+        return vector<string>(1, what);
+    }
+    for (size_t p = 0; p < g.gl_pathc; ++p) res.push_back(g.gl_pathv[p]);
+    globfree(&g);
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+size_t
+CorpusValidator::validate(const vector<string> &files, ostream &out) const
+{
+    const GrammarImage &image = this->image;
+    ThreadPool pool(this->nthreads);
+    /* small chunks keep threads busy when file sizes vary. the image being
+     * shared, claiming a chunk is the only thing threads contend on, and
+     * that is about 16 claims per thread for the whole corpus. per-thread
+     * deques and stealing would only pay off if files spawned more work or
+     * claims were frequent enough to fight over the cursor; neither holds
+     * for a flat list. chunks being fixed, b / grain also names the slot
+     * a chunk's verdicts go in, which keeps output in file order. */
+    size_t grain = max(size_t(1), files.size() / (16 * pool.size()));
+    vector<string> outs((files.size() + grain - 1) / grain);
+    vector<size_t> accepted(outs.size(), 0);
+    /* what is wrong with the grammar, if a chunk found out */
+    vector<string> faults(outs.size());
+
+    pool.parallelFor(files.size(), [&](size_t b, size_t e) {
+        ParseScratch scratch;
+        vector<char> bytes;
+        vector<SymbolID> input;
+        string &chunk = outs[b / grain];
+        size_t ok = 0;
+        /* exceptions can't leave the pool's threads */
+        try {
+            for (size_t f = b; f < e; ++f) {
+                string why;
+                size_t stuckAt = 0;
+                chunk += files[f];
+                if (!readInput(files[f], image, bytes, input, why)) {
+                    chunk += " error " + why + "\n";
+                }
+                else if (StrongLL1Parser::recognize(image, input, scratch,
+                                                    stuckAt)) {
+                    ++ok;
+                    chunk += " accept\n";
+                }
+                else chunk += " reject " + to_string(stuckAt) + "\n";
+            }
+        }
+        catch (DialectException &e) {
+            faults[b / grain] = e.what();
+        }
+        accepted[b / grain] = ok;
+    }, grain);
+    /* no file's verdict means anything then */
+    for (const string &fault : faults) {
+        if (fault.empty()) continue;
+        throw DialectException(DIALECT_WHERE, fault, false);
+    }
+    size_t res = 0;
+    for (size_t c = 0; c < outs.size(); ++c) {
+        out << outs[c];
+        res += accepted[c];
+    }
+    return res;
+}
@@ -0,0 +1,63 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CORPUS_VALIDATOR_H_INCLUDED
+#define CORPUS_VALIDATOR_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "GrammarImage.hxx"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* corpus validator class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* checks many input files against one grammar on a thread pool. the image is
+ * shared read-only by every thread. each chunk of files gets its own parse
+ * scratch and its own output buffer, and the buffers are written out in file
+ * order once the pool is done. */
+class CorpusValidator {
+private:
+    const GrammarImage &image;
+    size_t nthreads;
+
+public:
+    CorpusValidator(const GrammarImage &grammar,
+                    size_t threads) : image(grammar),
+                                      nthreads(0 == threads ? 1 : threads) { ; }
+
+    ~CorpusValidator(void) { ; }
+
+    /* the files what names: the files in a directory, the matches of a glob
+     * pattern, or just what */
+    static std::vector<std::string> expand(const std::string &what);
+
+    /* writes one line per file to out -- its path, then accept, reject and
+     * the offset the parse got stuck at, or error and why -- in the order
+     * of files. returns the number of files accepted. throws, writing
+     * nothing, if a file runs into a conflict of a grammar that is not
+     * LL(1). */
+    size_t validate(const std::vector<std::string> &files,
+                    std::ostream &out) const;
+};
+
+#endif
@@ -0,0 +1,210 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "CppEmitter.hxx"
+#include "Constants.hxx"
+#include "DialectException.hxx"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+#include <ctype.h>
+
+using namespace std;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* s as a c string literal */
+static string
+cString(const string &s)
+{
+    ostringstream res;
+
+    res << '"';
+    for (unsigned char c : s) {
+        if ('"' == c || '\\' == c) res << '\\' << c;
+        else if (isprint(c)) res << c;
+        else res << '\\' << oct << setw(3) << setfill('0') << unsigned(c);
+    }
+    res << '"';
+    return res.str();
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* s, safe to put in a comment */
+static string
+commentSafe(const string &s)
+{
+    string res = s;
+    size_t at = 0;
+
+    while (string::npos != (at = res.find("*/", at))) res.insert(++at, " ");
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+string
+CppEmitter::identifier(const string &path)
+{
+    string res = path.substr(string::npos == path.find_last_of('/') ?
+                             0 : path.find_last_of('/') + 1);
+
+    res = res.substr(0, res.find('.'));
+    for (auto &c : res) {
+        if (!isalnum(static_cast<unsigned char>(c))) c = '_';
+    }
+    if (res.empty() || isdigit(static_cast<unsigned char>(res[0]))) {
+        res = "_" + res;
+    }
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+CppEmitter::emit(ostream &out, const string &name, const string &origin) const
+{
+    const GrammarImage &g = this->image;
+    /* table column to symbol id */
+    vector<SymbolID> terms;
+    /* table row to symbol id */
+    vector<SymbolID> nonTerms;
+    string guard = "DIALECT_" + name + "_H_INCLUDED";
+
+    if (!g.strong()) {
+        string estr = "cannot emit a parser: grammar is not strong LL(1).";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    if (!g.lexer().empty()) {
+        string estr = "cannot emit a parser: generated parsers read bytes, "
+                      "and grammar has %token or %skip rules.";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    for (SymbolID id = 0; id < g.symbols(); ++id) {
+        uint32_t c = g.terminalIndex(id), r = g.nonTerminalIndex(id);
+        if (GrammarAnalysis::NONE != c) {
+            terms.resize(max<size_t>(terms.size(), c + 1));
+            terms[c] = id;
+        }
+        if (GrammarAnalysis::NONE != r) {
+            nonTerms.resize(max<size_t>(nonTerms.size(), r + 1));
+            nonTerms[r] = id;
+        }
+    }
+    transform(guard.begin(), guard.end(), guard.begin(), ::toupper);
+
+    out << "/* generated by dialect --emit-cpp from "
+        << commentSafe(origin) << ". do not edit." << endl;
+    out << " *" << endl;
+    for (size_t p = 0; p < g.productions(); ++p) {
+        out << " * " << commentSafe(g.str(p)) << endl;
+    }
+    out << " */" << endl << endl;
+    out << "#ifndef " << guard << endl;
+    out << "#define " << guard << endl << endl;
+    out << "#include <stddef.h>" << endl;
+    out << "#include <stdint.h>" << endl << endl;
+    out << "#include <vector>" << endl << endl;
+    out << "namespace " << name << " {" << endl << endl;
+
+    out << "static const size_t symbols = " << g.symbols() << ";" << endl;
+    out << "static const size_t productions = " << g.productions() << ";"
+        << endl << endl;
+
+    out << "/* symbol id to name */" << endl;
+    out << "static const char *const names[symbols] = {" << endl;
+    for (SymbolID id = 0; id < g.symbols(); ++id) {
+        out << "    " << cString(g.name(id)) << "," << endl;
+    }
+    out << "};" << endl << endl;
+
+    out << "/* the terminal every input byte spells, 0xffffffff where it "
+        << "spells none */" << endl;
+    out << "static const uint32_t byteTerminal[256] = {" << endl;
+    for (unsigned b = 0; b < 256; ++b) {
+        if (0 == b % 8) out << "   ";
+        out << " 0x" << hex << setw(8) << setfill('0')
+            << g.byteTerminals()[b] << dec << ",";
+        if (7 == b % 8) out << endl;
+    }
+    out << "};" << endl << endl;
+
+    out << "/* returns true if [begin, end) is a sentence of the grammar. if it"
+        << " is not" << endl
+        << " * and where is given, it gets the offset of the first byte that "
+        << "wasn't" << endl
+        << " * expected, or the length of the input if more was. */" << endl;
+    out << "inline bool" << endl;
+    out << "parse(const char *begin, const char *end, size_t *where = NULL)"
+        << endl;
+    out << "{" << endl;
+    out << "    std::vector<uint32_t> stack(1, " << SymbolTable::START << ");"
+        << endl;
+    out << "    const char *in = begin;" << endl;
+    out << "    uint32_t a = end == in ? " << SymbolTable::END
+        << " : byteTerminal[(unsigned char)*in];" << endl << endl;
+    out << "    stack.reserve(64);" << endl;
+    out << "    while (!stack.empty()) {" << endl;
+    out << "        uint32_t top = stack.back();" << endl;
+    out << "        stack.pop_back();" << endl;
+    out << "        switch (top) {" << endl;
+    for (size_t r = 0; r < nonTerms.size(); ++r) {
+        /* the columns of every production in this row */
+        map< uint32_t, vector<SymbolID> > cases;
+        for (size_t c = 0; c < terms.size(); ++c) {
+            uint32_t p = g.predict(r, c);
+            if (ParseTable::ERROR != p) cases[p].push_back(terms[c]);
+        }
+        if (cases.empty()) continue;
+        out << "            /* " << commentSafe(g.name(nonTerms[r])) << " */"
+            << endl;
+        out << "            case " << nonTerms[r] << ":" << endl;
+        out << "                switch (a) {" << endl;
+        for (auto &cs : cases) {
+            out << "                    /* " << commentSafe(g.str(cs.first))
+                << " */" << endl;
+            out << "                   ";
+            for (SymbolID t : cs.second) out << " case " << t << ":";
+            out << endl;
+            for (auto s = g.rhsEnd(cs.first); s != g.rhsBegin(cs.first);) {
+                out << "                        stack.push_back(" << *--s
+                    << ");" << endl;
+            }
+            out << "                        continue;" << endl;
+        }
+        out << "                }" << endl;
+        out << "                break;" << endl;
+    }
+    out << "            /* terminals */" << endl;
+    out << "            default:" << endl;
+    out << "                if (top != a) break;" << endl;
+    out << "                if (end != in) ++in;" << endl;
+    out << "                a = end == in ? " << SymbolTable::END
+        << " : byteTerminal[(unsigned char)*in];" << endl;
+    out << "                continue;" << endl;
+    out << "        }" << endl;
+    out << "        if (NULL != where) *where = in - begin;" << endl;
+    out << "        return false;" << endl;
+    out << "    }" << endl;
+    out << "    /* the stack only runs out once $ has been matched */" << endl;
+    out << "    return true;" << endl;
+    out << "}" << endl << endl;
+    out << "} /* namespace " << name << " */" << endl << endl;
+    out << "#endif" << endl;
+}
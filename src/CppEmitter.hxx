@@ -0,0 +1,58 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CPP_EMITTER_H_INCLUDED
+#define CPP_EMITTER_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "GrammarImage.hxx"
+
+#include <iostream>
+#include <string>
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* c++ code generator class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* writes a strong-LL(1) grammar out as a standalone c++ header that needs
+ * nothing but the standard library. the parse table is turned into code: one
+ * switch on the top of the stack with a switch on the lookahead per
+ * non-terminal, each case pushing its production's right-hand side as
+ * constants, all inside one loop so that input nesting can't overflow the
+ * call stack. */
+class CppEmitter {
+private:
+    const GrammarImage &image;
+
+public:
+    CppEmitter(const GrammarImage &image) : image(image) { ; }
+
+    ~CppEmitter(void) { ; }
+
+    /* a c++ identifier made out of the basename of path, sans extension */
+    static std::string identifier(const std::string &path);
+
+    /* name becomes the namespace of everything in the header. origin is only
+     * mentioned in comments. */
+    void emit(std::ostream &out,
+              const std::string &name,
+              const std::string &origin) const;
+};
+
+#endif
@@ -20,14 +20,24 @@
 #include <cstdio>
 #include <iostream>
 #include <string>
+#include <fstream>
+#include <vector>
 
 #include <string.h>
 #include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <getopt.h>
 
 #include "Constants.hxx"
 #include "DialectException.hxx"
 #include "CFG.hxx"
 #include "LL1Parser.hxx"
+#include "GrammarImage.hxx"
+#include "ParseTree.hxx"
+#include "PushParser.hxx"
+#include "CorpusValidator.hxx"
+#include "CppEmitter.hxx"
 #include "CFGParser.hh"
 #include "UserInputReader.hxx"
 
@@ -55,7 +65,36 @@ static void
 usage(void)
 {
     cout << endl << "usage:" << endl;
-    cout << "dialect [-q] cfgspec [input] [-]" << endl;
+    cout << "dialect [-q] [-j N] [--rewrite] [--tree | --stream | --errors N] "
+         << "cfgspec" << endl << "        [input] [-]" << endl;
+    cout << "dialect [-q] [-j N] [--rewrite] --compile cfgspec -o out.dlt"
+         << endl;
+    cout << "dialect [-q] [-j N] [--rewrite] --emit-cpp cfgspec -o out.hxx"
+         << endl;
+    cout << "dialect [-q] [-j N] [--rewrite] --batch cfgspec inputs [-]"
+         << endl;
+    cout << "dialect [-q] [-j N] [--rewrite] --corpus cfgspec path... [-]"
+         << endl;
+    cout << endl;
+    cout << "cfgspec may also be a grammar compiled with --compile." << endl;
+    cout << "--rewrite removes left recursion from the grammar and left "
+         << "factors it before" << endl << "it is tabled, so that more "
+         << "grammars are strong LL(1). without it, grammars" << endl
+         << "are parsed as written, as StaticGrammar parses them." << endl;
+    cout << "-q parses without tracing and prints only the verdict." << endl;
+    cout << "--tree prints the parse tree of input instead of tracing it. "
+         << "strong LL(1) grammars only." << endl;
+    cout << "--stream parses input as it is read, in memory that does not "
+         << "grow with it. strong LL(1) grammars only." << endl;
+    cout << "--errors N reports up to N syntax errors in input, getting past "
+         << "each one. 0" << endl << "means no limit." << endl;
+    cout << "--batch parses every line of inputs as an input of its own "
+         << "and prints" << endl << "its line number and verdict, with the "
+         << "offset a rejected input got stuck at." << endl;
+    cout << "--corpus parses every file that the paths name -- directories, "
+         << "glob patterns," << endl << "or files, and for -, the paths "
+         << "listed on stdin -- on N threads, printing" << endl
+         << "verdicts as --batch does." << endl;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -78,52 +117,508 @@ parseCFG(string what)
     }
 }
 
+/* ////////////////////////////////////////////////////////////////////////// */
+/* parses, cleans, and crunches the grammar in what, rewriting it first if
+ * asked to */
+static CFG *
+loadCFG(const string &what,
+        unsigned long nthreads,
+        bool verboseMode,
+        bool rewrite)
+{
+    /* do this before we ever touch contextFreeGrammar */
+    parseCFG(what);
+    contextFreeGrammar->threads(nthreads);
+    if (verboseMode) {
+        contextFreeGrammar->beVerbose();
+        contextFreeGrammar->emitState();
+    }
+    /* perform grammar hygiene */
+    contextFreeGrammar->clean();
+    /* rewrite what keeps it from being strong LL(1) where we can */
+    if (rewrite) contextFreeGrammar->transform();
+    /* prep grammar so that it can be fed to a parse table */
+    contextFreeGrammar->crunch();
+    return contextFreeGrammar;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static void
+compileCFG(const string &what,
+           const string &out,
+           unsigned long nthreads,
+           bool verboseMode,
+           bool rewrite)
+{
+    CFG *cfg = loadCFG(what, nthreads, verboseMode, rewrite);
+    StrongLL1Parser sll1(*cfg);
+    sll1.verbose(verboseMode);
+    const GrammarImage &image = sll1.compile();
+    image.save(out);
+    cout << "compiled " << what << " into " << out << " ("
+         << image.bytes() << " B)" << endl;
+    delete cfg;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the generated header's namespace is named after out */
+static void
+emitCpp(const string &what,
+        const string &out,
+        unsigned long nthreads,
+        bool verboseMode,
+        bool rewrite)
+{
+    GrammarImage image;
+
+    if (GrammarImage::sniff(what)) image.load(what);
+    else {
+        CFG *cfg = loadCFG(what, nthreads, verboseMode, rewrite);
+        StrongLL1Parser sll1(*cfg);
+        sll1.verbose(verboseMode);
+        /* copies share the bytes */
+        image = sll1.compile();
+        delete cfg;
+    }
+    ofstream file(out.c_str());
+    if (!file.is_open()) {
+        int err = errno;
+        string estr = "cannot open: " + out + ". why: " + strerror(err) + ".";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    CppEmitter(image).emit(file, CppEmitter::identifier(out), what);
+    file.close();
+    if (file.fail()) {
+        string estr = "cannot write: " + out + ".";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    cout << "emitted a parser for " << what << " into " << out << endl;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static void
+emitTree(StrongLL1Parser &sll1, SymbolView input)
+{
+    ParseTree tree;
+    ParseTreeBuilder<GrammarImage> builder(sll1.compile(), tree);
+
+    if (!sll1.parse(input, builder)) traceReject();
+    tree.emit(cout, sll1.compile());
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename Listener>
+static bool
+pushParse(int fd, StrongPushParser<GrammarImage, Listener> &parser)
+{
+    char chunk[1 << 16];
+    ssize_t n;
+
+    /* read() hands over whatever has arrived, so pipes and terminals are
+     * parsed as they are written to */
+    while (0 != (n = read(fd, chunk, sizeof(chunk)))) {
+        if (-1 == n && EINTR == errno) continue;
+        if (-1 == n) {
+            int err = errno;
+            string estr = "cannot read input. why: " + string(strerror(err));
+            throw DialectException(DIALECT_WHERE, estr);
+        }
+        if (!parser.feed(chunk, n)) return false;
+    }
+    return parser.finish();
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static void
+streamParse(const GrammarImage &image,
+            const string &fileToParse,
+            bool verboseMode)
+{
+    int fd = STDIN_FILENO;
+    bool ok = false;
+
+    if (!image.strong()) {
+        string estr = "grammar is not strong LL(1)";
+        throw DialectException(DIALECT_WHERE, estr, false);
+    }
+    if (!image.lexer().empty()) {
+        string estr = "--stream does not lex input. grammars with %token or "
+                      "%skip rules cannot be streamed.";
+        throw DialectException(DIALECT_WHERE, estr, false);
+    }
+    if ("-" != fileToParse &&
+        -1 == (fd = open(fileToParse.c_str(), O_RDONLY))) {
+        int err = errno;
+        string estr = "cannot open " + fileToParse + ". " + strerror(err) +
+                      ".";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    try {
+        if (verboseMode) {
+            TraceParseListener<GrammarImage> trace(image, "streaming parse");
+            StrongPushParser<GrammarImage,
+                             TraceParseListener<GrammarImage> > parser(image,
+                                                                       trace);
+            ok = pushParse(fd, parser);
+        }
+        else {
+            StrongPushParser<GrammarImage> parser(image);
+            ok = pushParse(fd, parser);
+        }
+    }
+    catch (DialectException &e) {
+        if (STDIN_FILENO != fd) close(fd);
+        throw;
+    }
+    if (STDIN_FILENO != fd) close(fd);
+    if (!ok) traceReject();
+    if (!verboseMode) {
+        cout << "*** success: input recognized by grammar ***" << endl;
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* rejects input read a byte at a time if one of its bytes spells no terminal */
+static void
+checkBytes(const UserInputReader &input)
+{
+    if (input.size() == input.unknownAt()) return;
+    cout << "byte " << input.unknownAt() << " (line " << input.unknownLine()
+         << ") of the input spells no terminal of the grammar" << endl;
+    traceReject();
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a verdict and nothing else. input read a byte at a time is parsed straight
+ * off its bytes when it can be, and isn't parsed at all if one of them spells
+ * no terminal. streamed input is parsed as it is read, so that is only known
+ * once it has been. */
+static void
+quietParse(StrongLL1Parser &sll1, UserInputReader &input)
+{
+    const GrammarImage &image = sll1.compile();
+    size_t stuckAt = 0;
+    bool ok = false;
+
+    try {
+        if (input.streamed()) {
+            StrongPushParser<GrammarImage> parser(image);
+            ok = input.stream(parser);
+            checkBytes(input);
+        }
+        else {
+            checkBytes(input);
+            if (!input.lexed() && image.strong()) {
+                ok = sll1.recognize(input.begin(), input.end(), stuckAt);
+            }
+            else ok = sll1.recognize(input.input());
+        }
+        if (!ok) traceReject();
+        cout << "*** success: input recognized by grammar ***" << endl;
+    }
+    catch (DialectException &e) {
+        /* a verdict, not a failure of dialect's, as LL1Parser::parse() and
+         * verbose mode have it */
+        cerr << e.what() << endl;
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a terminal the way syntax errors name it */
+static string
+spelled(const GrammarImage &image, SymbolID id)
+{
+    if (SymbolTable::END == id) return "end of input";
+    if (SymbolTable::NONE == id) return "a symbol that spells no terminal";
+    return "'" + image.name(id) + "'";
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static void
+reportErrors(StrongLL1Parser &sll1, SymbolView input, unsigned long budget)
+{
+    const GrammarImage &image = sll1.compile();
+    vector<ParseError> errors;
+    size_t stoppedAt = sll1.validate(input, budget, errors);
+
+    for (const ParseError &e : errors) {
+        vector<SymbolID> expects = image.expects(e.expected);
+        cout << "syntax error at " << e.offset << ": found "
+             << spelled(image, e.found) << ", expected ";
+        for (size_t t = 0; t < expects.size(); ++t) {
+            if (0 != t) cout << (expects.size() - 1 == t ? " or " : ", ");
+            cout << spelled(image, expects[t]);
+        }
+        cout << endl;
+    }
+    if (stoppedAt != input.size()) {
+        cout << "stopped at " << stoppedAt << " of " << input.size()
+             << " after " << errors.size() << " errors" << endl;
+    }
+    if (!errors.empty()) traceReject();
+    cout << "*** success: input recognized by grammar ***" << endl;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the grammar and its table are built once for all of the inputs */
+static void
+batchParse(StrongLL1Parser &sll1, const string &inputs)
+{
+    const SymbolID *byteTerminals = sll1.compile().byteTerminals();
+    const Lexer &lexer = sll1.compile().lexer();
+    ifstream file;
+    istream *in = &cin;
+    string line;
+    vector<SymbolID> input;
+    size_t id = 0, accepted = 0;
+    /* getline() leaves the '\r' of CRLF line endings behind. unless the
+     * grammar spells a terminal with it, it ends the line like '\n' does. */
+    bool crlf = SymbolTable::NONE == byteTerminals[uint8_t('\r')];
+
+    if ("-" != inputs) {
+        file.open(inputs.c_str());
+        if (!file.is_open()) {
+            int err = errno;
+            string estr = "cannot open " + inputs + ". " + strerror(err) + ".";
+            throw DialectException(DIALECT_WHERE, estr);
+        }
+        in = &file;
+    }
+    while (getline(*in, line)) {
+        size_t stuckAt = 0;
+        input.clear();
+        if (crlf && !line.empty() && '\r' == line[line.size() - 1]) {
+            line.erase(line.size() - 1);
+        }
+        if (!lexer.empty()) {
+            const char *b = line.data(), *e = b + line.size();
+            if (lexer.lex(b, e, input) != line.size()) {
+                input.push_back(SymbolTable::NONE);
+            }
+        }
+        else for (unsigned long c = 0; c < line.length(); ++c) {
+            input.push_back(byteTerminals[uint8_t(line[c])]);
+        }
+        /* a grammar that isn't LL(1) throws here, before the line is
+         * given a verdict */
+        bool ok = sll1.recognize(input, stuckAt);
+        cout << ++id;
+        if (ok) {
+            ++accepted;
+            cout << " accept\n";
+        }
+        else cout << " reject " << stuckAt << "\n";
+    }
+    cout << accepted << " of " << id << " inputs accepted" << endl;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static void
+corpusParse(const GrammarImage &image,
+            char **paths,
+            int npaths,
+            unsigned long nthreads)
+{
+    vector<string> files;
+
+    for (int p = 0; p < npaths; ++p) {
+        vector<string> named;
+        if ("-" == string(paths[p])) {
+            string line;
+            while (getline(cin, line)) named.push_back(line);
+        }
+        else named = CorpusValidator::expand(paths[p]);
+        files.insert(files.end(), named.begin(), named.end());
+    }
+    size_t accepted = CorpusValidator(image, nthreads).validate(files, cout);
+    cout << accepted << " of " << files.size() << " inputs accepted" << endl;
+}
+
 /* ////////////////////////////////////////////////////////////////////////// */
 /* ////////////////////////////////////////////////////////////////////////// */
 int
 main(int argc, char **argv)
 {
-    bool verboseMode = true;
-    string cfgDescription, fileToParse;
+    static const struct option longOptions[] = {
+        {"quiet",    no_argument,       NULL, 'q'},
+        {"jobs",     required_argument, NULL, 'j'},
+        {"compile",  no_argument,       NULL, 'c'},
+        {"output",   required_argument, NULL, 'o'},
+        {"emit-cpp", no_argument,       NULL, 'e'},
+        {"tree",     no_argument,       NULL, 't'},
+        {"stream",   no_argument,       NULL, 's'},
+        {"batch",    no_argument,       NULL, 'b'},
+        {"corpus",   no_argument,       NULL, 'p'},
+        {"errors",   required_argument, NULL, 'r'},
+        {"rewrite",  no_argument,       NULL, 'w'},
+        {NULL,       0,                 NULL, 0}
+    };
+    enum { PARSE, COMPILE, EMIT_CPP, BATCH, CORPUS } mode = PARSE;
+    bool verboseMode = true, printTree = false, streamInput = false;
+    bool recover = false, rewrite = false;
+    unsigned long nthreads = 1, budget = 0;
+    string cfgDescription, fileToParse, outFile;
+    int opt;
 
-    if (3 != argc && 4 != argc) {
+    while (-1 != (opt = getopt_long(argc, argv, "qj:co:", longOptions, NULL))) {
+        switch (opt) {
+            case 'q':
+                verboseMode = false;
+                break;
+            case 'j': {
+                char *end = NULL;
+                nthreads = strtoul(optarg, &end, 10);
+                if ('\0' != *end || 0 == nthreads) {
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                break;
+            }
+            case 'c':
+                mode = COMPILE;
+                break;
+            case 'e':
+                mode = EMIT_CPP;
+                break;
+            case 'b':
+                mode = BATCH;
+                break;
+            case 'p':
+                mode = CORPUS;
+                break;
+            case 'r': {
+                char *end = NULL;
+                budget = strtoul(optarg, &end, 10);
+                if ('\0' != *end) {
+                    usage();
+                    return EXIT_FAILURE;
+                }
+                recover = true;
+                break;
+            }
+            case 'o':
+                outFile = string(optarg);
+                break;
+            case 't':
+                printTree = true;
+                break;
+            case 's':
+                streamInput = true;
+                break;
+            case 'w':
+                rewrite = true;
+                break;
+            default:
+                usage();
+                return EXIT_FAILURE;
+        }
+    }
+    if (COMPILE == mode || EMIT_CPP == mode ?
+            (1 != argc - optind || outFile.empty()) :
+            ((CORPUS == mode ? 2 > argc - optind : 2 != argc - optind) ||
+             !outFile.empty() || 1 < printTree + streamInput + recover ||
+             (PARSE != mode && (printTree || streamInput || recover)))) {
         usage();
         return EXIT_FAILURE;
     }
-    else if (3 == argc) {
-        cfgDescription = string(argv[1]);
-        fileToParse = string(argv[2]);
-    }
-    else {
-        if ("-q" != string(argv[1])) {
-            usage();
-            return EXIT_FAILURE;
-        }
-        cfgDescription = string(argv[2]);
-        fileToParse = string(argv[3]);
-        verboseMode = false;
-    }
+    cfgDescription = string(argv[optind]);
     try {
         echoHeader();
-        /* do this before we ever touch contextFreeGrammar */
-        parseCFG(cfgDescription);
-        if (verboseMode) {
-            contextFreeGrammar->beVerbose();
-            contextFreeGrammar->emitState();
-        }
-        /* perform grammar hygiene */
-        contextFreeGrammar->clean();
-        /* prep grammar so that it can be fed to a parse table */
-        contextFreeGrammar->crunch();
-        /* init ll1 parser */
-        LL1Parser ll1(*contextFreeGrammar);
-        /* set verbosity */
-        ll1.verbose(verboseMode);
-        /* try to parse -- catch any funk */
-        UserInputReader inputParser(fileToParse);
-        ll1.parse(inputParser.input());
+        if (COMPILE == mode) {
+            compileCFG(cfgDescription, outFile, nthreads, verboseMode,
+                       rewrite);
+            return EXIT_SUCCESS;
+        }
+        if (EMIT_CPP == mode) {
+            emitCpp(cfgDescription, outFile, nthreads, verboseMode, rewrite);
+            return EXIT_SUCCESS;
+        }
+        fileToParse = string(argv[optind + 1]);
+        /* see quietParse() */
+        bool quiet = !verboseMode && !printTree && !recover;
+        /* compiled grammars skip straight to parsing */
+        if (GrammarImage::sniff(cfgDescription)) {
+            GrammarImage image;
+            image.load(cfgDescription);
+            if (BATCH == mode) {
+                StrongLL1Parser sll1(image);
+                batchParse(sll1, fileToParse);
+                return EXIT_SUCCESS;
+            }
+            if (CORPUS == mode) {
+                corpusParse(image, argv + optind + 1, argc - optind - 1,
+                            nthreads);
+                return EXIT_SUCCESS;
+            }
+            if (streamInput) {
+                streamParse(image, fileToParse, verboseMode);
+                return EXIT_SUCCESS;
+            }
+            /* only quiet parses of strong grammars take input as it comes */
+            UserInputReader inputParser(fileToParse, image,
+                                        quiet && image.strong());
+            if (recover) {
+                StrongLL1Parser sll1(image);
+                reportErrors(sll1, inputParser.input(), budget);
+                return EXIT_SUCCESS;
+            }
+            if (printTree) {
+                StrongLL1Parser sll1(image);
+                emitTree(sll1, inputParser.input());
+                return EXIT_SUCCESS;
+            }
+            if (!verboseMode) {
+                StrongLL1Parser sll1(image);
+                quietParse(sll1, inputParser);
+                return EXIT_SUCCESS;
+            }
+            LL1Parser ll1(image);
+            ll1.verbose(verboseMode);
+            ll1.parse(inputParser.input());
+            return EXIT_SUCCESS;
+        }
+        CFG *cfg = loadCFG(cfgDescription, nthreads, verboseMode, rewrite);
+        if (BATCH == mode) {
+            StrongLL1Parser sll1(*cfg);
+            sll1.verbose(verboseMode);
+            batchParse(sll1, fileToParse);
+            delete cfg;
+            return EXIT_SUCCESS;
+        }
+        if (CORPUS == mode) {
+            StrongLL1Parser sll1(*cfg);
+            sll1.verbose(verboseMode);
+            corpusParse(sll1.compile(), argv + optind + 1, argc - optind - 1,
+                        nthreads);
+            delete cfg;
+            return EXIT_SUCCESS;
+        }
+        if (streamInput) {
+            StrongLL1Parser sll1(*cfg);
+            sll1.verbose(verboseMode);
+            streamParse(sll1.compile(), fileToParse, verboseMode);
+            delete cfg;
+            return EXIT_SUCCESS;
+        }
+        StrongLL1Parser sll1(*cfg);
+        sll1.verbose(verboseMode);
+        UserInputReader inputParser(fileToParse, *cfg,
+                                    quiet && sll1.compile().strong());
+        if (printTree || recover) {
+            if (printTree) emitTree(sll1, inputParser.input());
+            else reportErrors(sll1, inputParser.input(), budget);
+        }
+        else if (!verboseMode) quietParse(sll1, inputParser);
+        else {
+            /* init ll1 parser */
+            LL1Parser ll1(*cfg);
+            /* set verbosity */
+            ll1.verbose(verboseMode);
+            /* try to parse -- catch any funk */
+            ll1.parse(inputParser.input());
+        }
         /* done! */
-        delete contextFreeGrammar;
+        delete cfg;
     }
     catch (DialectException &e) {
         cerr << e.what() << endl;
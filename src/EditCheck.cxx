@@ -0,0 +1,216 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* checks StrongLL1Parser::addProduction() and removeProduction() against
+ * building the edited grammar from scratch. random grammars get random edits,
+ * and after each one the incremental parser and a fresh one must agree on
+ * nullable, FIRST, and FOLLOW, on every table cell, on which cells conflict,
+ * and on strong(). run by make check. */
+
+#include "CFG.hxx"
+#include "DialectException.hxx"
+#include "GrammarImage.hxx"
+#include "LL1Parser.hxx"
+#include "ParseTable.hxx"
+
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+/* what random grammars are made of */
+static const string NON_TERMINALS = "ABCDEFG";
+static const string TERMINALS = "abcd";
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a random right-hand side of at most three symbols */
+static string
+randomRHS(mt19937 &rng)
+{
+    string res;
+
+    for (size_t n = rng() % 4; 0 != n; --n) {
+        const string &from = 0 == rng() % 2 ? NON_TERMINALS : TERMINALS;
+        res += from[rng() % from.size()];
+    }
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the cells that conflict, as (non-terminal, terminal) pairs */
+static set< pair<SymbolID, SymbolID> >
+conflictCells(const vector<ParseConflict> &conflicts)
+{
+    set< pair<SymbolID, SymbolID> > res;
+
+    for (const ParseConflict &c : conflicts) {
+        res.insert(make_pair(c.nonTerminal, c.terminal));
+    }
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the first way in which the two parsers differ, or "" if they don't. both
+ * grammars share one symbol numbering. */
+static string
+compare(StrongLL1Parser &edited, StrongLL1Parser &fresh)
+{
+    const GrammarAnalysis &ea = edited.grammar().analysis();
+    const GrammarAnalysis &fa = fresh.grammar().analysis();
+    const SymbolTable &symbols = edited.grammar().symbols();
+    const GrammarImage &ei = edited.compile();
+    const GrammarImage &fi = fresh.compile();
+
+    if (set<SymbolID>(ea.nonTerminals().begin(), ea.nonTerminals().end()) !=
+        set<SymbolID>(fa.nonTerminals().begin(), fa.nonTerminals().end())) {
+        return "non-terminals";
+    }
+    for (SymbolID nt : ea.nonTerminals()) {
+        string name = symbols.name(nt);
+        if (ea.nullable(nt) != fa.nullable(nt)) return "nullable(" + name + ")";
+        for (SymbolID t : fa.terminals()) {
+            if (ei.inFirst(nt, t) != fi.inFirst(nt, t)) {
+                return "FIRST(" + name + ")";
+            }
+            if (ei.inFollow(nt, t) != fi.inFollow(nt, t)) {
+                return "FOLLOW(" + name + ")";
+            }
+        }
+    }
+    auto ec = conflictCells(edited.conflicts());
+    auto fc = conflictCells(fresh.conflicts());
+    if (ec != fc) return "conflicts()";
+    if (ei.strong() != fi.strong()) return "strong()";
+    for (SymbolID nt : fa.nonTerminals()) {
+        for (SymbolID t : fa.terminals()) {
+            /* which production wins a conflict depends on their order */
+            if (fc.end() != fc.find(make_pair(nt, t))) continue;
+            uint32_t ep = ei.predict(ei.nonTerminalIndex(nt),
+                                     ei.terminalIndex(t));
+            uint32_t fp = fi.predict(fi.nonTerminalIndex(nt),
+                                     fi.terminalIndex(t));
+            if ((ParseTable::ERROR == ep) != (ParseTable::ERROR == fp) ||
+                (ParseTable::ERROR != ep && ei.str(ep) != fi.str(fp))) {
+                return "cell [" + symbols.name(nt) + "][" +
+                       symbols.name(t) + "]";
+            }
+        }
+    }
+    return "";
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the productions of cfg, but for the augmented start production, with one
+ * of what it derives first so that a CFG built from them starts the same
+ * way. empty if nothing derives it anymore. */
+static vector<CFGProduction>
+sourceProductions(const CFG &cfg)
+{
+    const CFGProductions &prods = cfg.prods();
+    SymbolID start = *prods.rhsBegin(0);
+    vector<CFGProduction> res;
+
+    for (size_t p = 1; p < prods.size(); ++p) {
+        res.push_back(prods.at(p));
+        if (start == res.back().lhs() && start != res.front().lhs()) {
+            swap(res.front(), res.back());
+        }
+    }
+    if (res.empty() || start != res.front().lhs()) res.clear();
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static void
+dump(const CFG &cfg)
+{
+    for (size_t p = 0; p < cfg.prods().size(); ++p) {
+        cerr << "  " << cfg.prods().str(p, cfg.symbols()) << endl;
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+int
+main(int argc, char **argv)
+{
+    if (argc > 3) {
+        cerr << "usage: dialect-editcheck [seed] [grammars]" << endl;
+        return EXIT_FAILURE;
+    }
+    unsigned long seed = argc > 1 ? strtoul(argv[1], NULL, 10) : 1;
+    size_t grammars = argc > 2 ? strtoul(argv[2], NULL, 10) : 2000;
+    mt19937 rng(seed);
+    size_t edits = 0, checked = 0;
+
+    try {
+        for (size_t g = 0; g < grammars; ++g) {
+            SymbolTable symbols;
+            vector<CFGProduction> prods;
+            for (size_t n = 2 + rng() % 8; 0 != n; --n) {
+                char lhs = NON_TERMINALS[prods.empty() ?
+                                         0 : rng() % NON_TERMINALS.size()];
+                prods.push_back(CFGProduction(symbols, string(1, lhs),
+                                              randomRHS(rng)));
+            }
+            CFG cfg(symbols, prods);
+            cfg.crunch();
+            StrongLL1Parser edited(cfg);
+            edited.compile();
+            for (size_t e = 0; e < 6; ++e) {
+                const CFG &now = edited.grammar();
+                if (0 == rng() % 2 && 2 < now.prods().size()) {
+                    edited.removeProduction(1 + rng() % (now.prods().size() -
+                                                         1));
+                }
+                else {
+                    string lhs(1, NON_TERMINALS[rng() % NON_TERMINALS.size()]);
+                    vector<SymbolID> rhs;
+                    for (char c : randomRHS(rng)) {
+                        rhs.push_back(edited.intern(string(1, c)));
+                    }
+                    SymbolID id = edited.intern(lhs);
+                    edited.addProduction(CFGProduction(id, rhs));
+                }
+                ++edits;
+                vector<CFGProduction> source = sourceProductions(now);
+                if (source.empty()) continue;
+                CFG rebuilt(now.symbols(), source);
+                rebuilt.crunch();
+                StrongLL1Parser fresh(rebuilt);
+                string diff = compare(edited, fresh);
+                ++checked;
+                if (diff.empty()) continue;
+                cerr << "grammar " << g << ", edit " << e << ": " << diff
+                     << " differs from a fresh build of" << endl;
+                dump(now);
+                return EXIT_FAILURE;
+            }
+        }
+    }
+    catch (DialectException &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    cout << "seed " << seed << ": " << edits << " edits, " << checked
+         << " checked against a fresh build" << endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,935 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GrammarAnalysis.hxx"
+#include "CFG.hxx"
+#include "ThreadPool.hxx"
+
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* BitMatrix */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+BitMatrix::resize(size_t rows, size_t cols)
+{
+    this->nwords = (cols + 63) / 64;
+    this->bits.assign(rows * this->nwords, 0);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+BitMatrix::grow(size_t rows, size_t cols)
+{
+    size_t nw = (cols + 63) / 64, oldRows = this->rows();
+
+    if (nw == this->nwords || 0 == oldRows) {
+        this->nwords = nw;
+        this->bits.resize(rows * nw, 0);
+        return;
+    }
+    /* rows got wider, so everything has to move */
+    vector<uint64_t> wider(rows * nw, 0);
+    for (size_t r = 0; r < min(rows, oldRows); ++r) {
+        copy(this->row(r), this->row(r) + min(nw, this->nwords),
+             wider.data() + r * nw);
+    }
+    this->nwords = nw;
+    this->bits.swap(wider);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+BitMatrix::merge(uint64_t *dst, const uint64_t *src, size_t nwords)
+{
+    uint64_t changed = 0;
+    size_t w = 0;
+
+#if defined(__AVX2__)
+    __m256i vchanged = _mm256_setzero_si256();
+    for (; w + 4 <= nwords; w += 4) {
+        __m256i d = _mm256_loadu_si256((const __m256i *)(dst + w));
+        __m256i s = _mm256_loadu_si256((const __m256i *)(src + w));
+        __m256i o = _mm256_or_si256(d, s);
+        vchanged = _mm256_or_si256(vchanged, _mm256_xor_si256(o, d));
+        _mm256_storeu_si256((__m256i *)(dst + w), o);
+    }
+    changed |= !_mm256_testz_si256(vchanged, vchanged);
+#elif defined(__SSE2__)
+    __m128i vchanged = _mm_setzero_si128();
+    for (; w + 2 <= nwords; w += 2) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dst + w));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + w));
+        __m128i o = _mm_or_si128(d, s);
+        vchanged = _mm_or_si128(vchanged, _mm_xor_si128(o, d));
+        _mm_storeu_si128((__m128i *)(dst + w), o);
+    }
+    __m128i zero = _mm_setzero_si128();
+    changed |= (0xFFFF != _mm_movemask_epi8(_mm_cmpeq_epi8(vchanged, zero)));
+#endif
+    for (; w < nwords; ++w) {
+        uint64_t o = dst[w] | src[w];
+        changed |= o ^ dst[w];
+        dst[w] = o;
+    }
+    return 0 != changed;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* Digraph */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+Digraph::build(size_t nnodes,
+               const vector< pair<uint32_t, uint32_t> > &edges)
+{
+    this->offsets.assign(nnodes + 1, 0);
+    this->targets.resize(edges.size());
+    for (const pair<uint32_t, uint32_t> &e : edges) {
+        ++this->offsets[e.first + 1];
+    }
+    for (size_t v = 0; v < nnodes; ++v) {
+        this->offsets[v + 1] += this->offsets[v];
+    }
+    vector<uint32_t> fill(this->offsets.begin(), this->offsets.end() - 1);
+    for (const pair<uint32_t, uint32_t> &e : edges) {
+        this->targets[fill[e.first]++] = e.second;
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+namespace {
+/* one pending traverse() call */
+struct DigraphFrame {
+    /* node being traversed */
+    uint32_t node;
+    /* next successor edge to walk */
+    uint32_t edge;
+    /* stack depth at which node was pushed */
+    uint32_t depth;
+};
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* this is the usual recursive traverse(), but with an explicit call stack so
+ * that very deep relations can't blow the real one. */
+size_t
+Digraph::traverse(BitMatrix *F,
+                  vector<uint32_t> *comp,
+                  vector<uint32_t> *level) const
+{
+    static const uint32_t INF = UINT32_MAX;
+    size_t nnodes = this->nodes(), nwords = F ? F->words() : 0, visits = 0;
+    uint32_t ncomps = 0;
+    vector<uint32_t> N(nnodes, 0), stk;
+    /* highest level of any component reachable from a node so far */
+    vector<uint32_t> lvl;
+    vector<DigraphFrame> calls;
+
+    if (comp) {
+        comp->assign(nnodes, 0);
+        level->clear();
+        lvl.assign(nnodes, 0);
+    }
+    for (uint32_t root = 0; root < nnodes; ++root) {
+        if (0 != N[root]) continue;
+        stk.push_back(root);
+        N[root] = stk.size();
+        calls.push_back(DigraphFrame{root, this->offsets[root],
+                                     N[root]});
+        while (!calls.empty()) {
+            DigraphFrame &f = calls.back();
+            uint32_t x = f.node;
+            if (f.edge < this->offsets[x + 1]) {
+                uint32_t y = this->targets[f.edge];
+                if (0 == N[y]) {
+                    /* descend. the edge is accounted for on the way back. */
+                    stk.push_back(y);
+                    N[y] = stk.size();
+                    calls.push_back(DigraphFrame{y, this->offsets[y],
+                                                 N[y]});
+                    continue;
+                }
+                /* a finished target is in another, finished component. an
+                 * unfinished one is in x's component. */
+                if (comp && INF == N[y]) {
+                    lvl[x] = max(lvl[x], (*level)[(*comp)[y]] + 1);
+                }
+                N[x] = min(N[x], N[y]);
+                if (F) BitMatrix::merge(F->row(x), F->row(y), nwords);
+                ++visits;
+                ++f.edge;
+                continue;
+            }
+            /* x is done. if it is the root of a component, everything above
+             * it on the stack shares its set. */
+            if (N[x] == f.depth) {
+                for (;;) {
+                    uint32_t top = stk.back();
+                    stk.pop_back();
+                    N[top] = INF;
+                    if (comp) (*comp)[top] = ncomps;
+                    if (top == x) break;
+                    if (F) copy(F->row(x), F->row(x) + nwords, F->row(top));
+                }
+                if (comp) level->push_back(lvl[x]);
+                ++ncomps;
+            }
+            calls.pop_back();
+            if (!calls.empty()) {
+                DigraphFrame &parent = calls.back();
+                uint32_t p = parent.node;
+                if (comp) {
+                    lvl[p] = max(lvl[p], INF == N[x] ?
+                                         (*level)[(*comp)[x]] + 1 : lvl[x]);
+                }
+                N[p] = min(N[p], N[x]);
+                if (F) BitMatrix::merge(F->row(p), F->row(x), nwords);
+                ++visits;
+                ++parent.edge;
+            }
+        }
+    }
+    return visits;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+size_t
+Digraph::closure(BitMatrix &F) const
+{
+    return this->traverse(&F, NULL, NULL);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+size_t
+Digraph::closure(BitMatrix &F, ThreadPool &pool) const
+{
+    if (pool.size() < 2) return this->closure(F);
+
+    size_t nnodes = this->nodes(), nwords = F.words();
+    vector<uint32_t> comp, level;
+    size_t visits = this->traverse(NULL, &comp, &level);
+    size_t ncomps = level.size();
+    uint32_t nlevels = 0;
+
+    for (uint32_t l : level) nlevels = max(nlevels, l + 1);
+    /* members of every component and components of every level, in
+     * compressed sparse row form */
+    vector<uint32_t> memOffsets(ncomps + 1, 0), members(nnodes);
+    vector<uint32_t> lvlOffsets(nlevels + 1, 0), byLevel(ncomps);
+    for (uint32_t v = 0; v < nnodes; ++v) ++memOffsets[comp[v] + 1];
+    for (size_t c = 0; c < ncomps; ++c) {
+        memOffsets[c + 1] += memOffsets[c];
+        ++lvlOffsets[level[c] + 1];
+    }
+    for (uint32_t l = 0; l < nlevels; ++l) lvlOffsets[l + 1] += lvlOffsets[l];
+    vector<uint32_t> mfill(memOffsets.begin(), memOffsets.end() - 1);
+    vector<uint32_t> lfill(lvlOffsets.begin(), lvlOffsets.end() - 1);
+    for (uint32_t v = 0; v < nnodes; ++v) members[mfill[comp[v]]++] = v;
+    for (uint32_t c = 0; c < ncomps; ++c) byLevel[lfill[level[c]]++] = c;
+
+    atomic<size_t> mergeVisits(0);
+    /* every component only depends on components of lower levels, so all the
+     * components of a level can be merged at once. */
+    for (uint32_t l = 0; l < nlevels; ++l) {
+        size_t n = lvlOffsets[l + 1] - lvlOffsets[l];
+        size_t grain = max(size_t(16), n / (pool.size() * 8));
+        pool.parallelFor(n, [&](size_t b, size_t e) {
+            size_t lvisits = 0;
+            for (size_t i = b; i < e; ++i) {
+                uint32_t c = byLevel[lvlOffsets[l] + i];
+                const uint32_t *mb = members.data() + memOffsets[c];
+                const uint32_t *me = members.data() + memOffsets[c + 1];
+                uint64_t *rep = F.row(*mb);
+                for (const uint32_t *m = mb; me != m; ++m) {
+                    if (mb != m) BitMatrix::merge(rep, F.row(*m), nwords);
+                    for (auto y = this->succBegin(*m);
+                         this->succEnd(*m) != y; ++y) {
+                        if (c != comp[*y]) {
+                            BitMatrix::merge(rep, F.row(*y), nwords);
+                        }
+                        ++lvisits;
+                    }
+                }
+                for (const uint32_t *m = mb + 1; me > m; ++m) {
+                    copy(rep, rep + nwords, F.row(*m));
+                }
+            }
+            mergeVisits += lvisits;
+        }, grain);
+    }
+    return visits + mergeVisits;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ProductionIndex */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ProductionIndex::relist(vector<uint32_t> &list, uint32_t from, uint32_t to)
+{
+    auto i = find(list.begin(), list.end(), from);
+    if (list.end() != i) *i = to;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ProductionIndex::unlist(vector<uint32_t> &list, uint32_t p)
+{
+    auto i = find(list.begin(), list.end(), p);
+    if (list.end() == i) return;
+    *i = list.back();
+    list.pop_back();
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ProductionIndex::build(size_t nsymbols, const CFGProductions &productions)
+{
+    this->lhsProds.assign(nsymbols, vector<uint32_t>());
+    this->rhsProds.assign(nsymbols, vector<uint32_t>());
+    for (size_t p = 0; p < productions.size(); ++p) this->add(productions, p);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ProductionIndex::add(const CFGProductions &productions, uint32_t p)
+{
+    SymbolID maxID = productions.lhs(p);
+    const SymbolID *rend = productions.rhsEnd(p);
+
+    for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+        maxID = max(maxID, *s);
+    }
+    /* symbols interned after build() */
+    if (maxID >= this->lhsProds.size()) {
+        this->lhsProds.resize(maxID + 1);
+        this->rhsProds.resize(maxID + 1);
+    }
+    this->lhsProds[productions.lhs(p)].push_back(p);
+    for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+        this->rhsProds[*s].push_back(p);
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ProductionIndex::remove(const CFGProductions &productions, uint32_t p)
+{
+    unlist(this->lhsProds[productions.lhs(p)], p);
+    const SymbolID *rend = productions.rhsEnd(p);
+    for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+        unlist(this->rhsProds[*s], p);
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ProductionIndex::move(const CFGProductions &productions,
+                      uint32_t from,
+                      uint32_t to)
+{
+    relist(this->lhsProds[productions.lhs(from)], from, to);
+    const SymbolID *rend = productions.rhsEnd(from);
+    for (auto s = productions.rhsBegin(from); rend != s; ++s) {
+        relist(this->rhsProds[*s], from, to);
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* GrammarAnalysis */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+const uint32_t GrammarAnalysis::NONE;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+GrammarAnalysis::init(const SymbolTable &symbols,
+                      const CFGProductions &productions)
+{
+    vector<bool> seen(symbols.size(), false);
+
+    this->termIndex.assign(symbols.size(), NONE);
+    this->nonTermIndex.assign(symbols.size(), NONE);
+    this->terms.clear();
+    this->nonTerms.clear();
+    this->nedges = 0;
+    this->nvisits = 0;
+    ++this->nlayouts;
+
+    /* $ is always a terminal of an augmented grammar */
+    seen[SymbolTable::END] = true;
+    for (size_t p = 0; p < productions.size(); ++p) {
+        seen[productions.lhs(p)] = true;
+        const SymbolID *rend = productions.rhsEnd(p);
+        for (auto s = productions.rhsBegin(p); rend != s; ++s) seen[*s] = true;
+    }
+    for (SymbolID id = 0; id < symbols.size(); ++id) {
+        if (!seen[id]) continue;
+        if (symbols.terminal(id)) {
+            this->termIndex[id] = this->terms.size();
+            this->terms.push_back(id);
+        }
+        else {
+            this->nonTermIndex[id] = this->nonTerms.size();
+            this->nonTerms.push_back(id);
+        }
+    }
+    this->nullBits.resize(1, this->nonTerms.size());
+    this->firstBits.resize(this->nonTerms.size(), this->terms.size());
+    this->followBits.resize(this->nonTerms.size(), this->terms.size());
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* nullable is a plain counting worklist: every production keeps the number of
+ * right-hand side symbols not yet known to be nullable, and every non-terminal
+ * knows where it occurs. a non-terminal is dequeued at most once, so every
+ * occurrence is visited at most once. */
+void
+GrammarAnalysis::computeNullable(const CFGProductions &productions)
+{
+    size_t nnts = this->nonTerms.size();
+    vector<uint32_t> remaining(productions.size(), 0);
+    /* occurrences of every non-terminal, in compressed sparse row form */
+    vector<uint32_t> occOffsets(nnts + 1, 0), occs;
+    vector<uint32_t> work;
+
+    for (size_t p = 0; p < productions.size(); ++p) {
+        const SymbolID *rend = productions.rhsEnd(p);
+        for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+            uint32_t nt = this->nonTermIndex[*s];
+            /* a terminal can never go away */
+            if (NONE == nt) remaining[p] = UINT32_MAX;
+            else ++occOffsets[nt + 1];
+        }
+    }
+    for (size_t nt = 0; nt < nnts; ++nt) occOffsets[nt + 1] += occOffsets[nt];
+    occs.resize(occOffsets[nnts]);
+    vector<uint32_t> fill(occOffsets.begin(), occOffsets.end() - 1);
+    for (size_t p = 0; p < productions.size(); ++p) {
+        const SymbolID *rend = productions.rhsEnd(p);
+        for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+            uint32_t nt = this->nonTermIndex[*s];
+            if (NONE == nt) continue;
+            occs[fill[nt]++] = p;
+            if (UINT32_MAX != remaining[p]) ++remaining[p];
+        }
+    }
+    this->nedges += occs.size();
+
+    for (size_t p = 0; p < productions.size(); ++p) {
+        uint32_t nt = this->nonTermIndex[productions.lhs(p)];
+        if (0 == remaining[p] && !this->nullBits.test(0, nt)) {
+            this->nullBits.set(0, nt);
+            work.push_back(nt);
+        }
+    }
+    while (!work.empty()) {
+        uint32_t nt = work.back(); work.pop_back();
+        for (uint32_t o = occOffsets[nt]; o < occOffsets[nt + 1]; ++o) {
+            uint32_t p = occs[o];
+            ++this->nvisits;
+            if (UINT32_MAX == remaining[p] || 0 != --remaining[p]) continue;
+            uint32_t lhs = this->nonTermIndex[productions.lhs(p)];
+            if (!this->nullBits.test(0, lhs)) {
+                this->nullBits.set(0, lhs);
+                work.push_back(lhs);
+            }
+        }
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* FIRST(A) is everything A can start with directly, plus FIRST(B) for every
+ * A --> alpha B beta where alpha is nullable. */
+void
+GrammarAnalysis::computeFirstSets(const CFGProductions &productions,
+                                  ThreadPool *pool)
+{
+    vector< pair<uint32_t, uint32_t> > edges;
+    Digraph g;
+
+    for (size_t p = 0; p < productions.size(); ++p) {
+        uint32_t lhs = this->nonTermIndex[productions.lhs(p)];
+        const SymbolID *rend = productions.rhsEnd(p);
+        for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+            uint32_t t = this->termIndex[*s];
+            if (NONE != t) {
+                this->firstBits.set(lhs, t);
+                break;
+            }
+            uint32_t nt = this->nonTermIndex[*s];
+            edges.push_back(make_pair(lhs, nt));
+            if (!this->nullBits.test(0, nt)) break;
+        }
+    }
+    g.build(this->nonTerms.size(), edges);
+    this->nedges += g.edges();
+    this->nvisits += pool ? g.closure(this->firstBits, *pool)
+                          : g.closure(this->firstBits);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* for A --> alpha B beta, FIRST(beta) is in FOLLOW(B) and, if beta is nullable,
+ * so is FOLLOW(A). right-hand sides are walked right to left so that
+ * FIRST(beta) is built up incrementally. */
+void
+GrammarAnalysis::computeFollowSets(const CFGProductions &productions,
+                                   ThreadPool *pool)
+{
+    size_t nwords = this->followBits.words();
+    vector< pair<uint32_t, uint32_t> > edges;
+    vector<uint64_t> fob(nwords);
+    Digraph g;
+
+    /* init S''s follow set to include $ */
+    if (NONE != this->nonTerminalIndex(SymbolTable::START)) {
+        this->followBits.set(this->nonTermIndex[SymbolTable::START],
+                             this->termIndex[SymbolTable::END]);
+    }
+    for (size_t p = 0; p < productions.size(); ++p) {
+        uint32_t lhs = this->nonTermIndex[productions.lhs(p)];
+        const SymbolID *rbegin = productions.rhsBegin(p);
+        bool betaNullable = true;
+        fill(fob.begin(), fob.end(), 0);
+        for (auto s = productions.rhsEnd(p); rbegin != s;) {
+            --s;
+            uint32_t t = this->termIndex[*s];
+            if (NONE != t) {
+                fill(fob.begin(), fob.end(), 0);
+                fob[t >> 6] |= uint64_t(1) << (t & 63);
+                betaNullable = false;
+                continue;
+            }
+            uint32_t nt = this->nonTermIndex[*s];
+            BitMatrix::merge(this->followBits.row(nt), fob.data(), nwords);
+            if (betaNullable) edges.push_back(make_pair(nt, lhs));
+            if (!this->nullBits.test(0, nt)) {
+                fill(fob.begin(), fob.end(), 0);
+                betaNullable = false;
+            }
+            BitMatrix::merge(fob.data(), this->firstBits.row(nt), nwords);
+        }
+    }
+    g.build(this->nonTerms.size(), edges);
+    this->nedges += g.edges();
+    this->nvisits += pool ? g.closure(this->followBits, *pool)
+                          : g.closure(this->followBits);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+GrammarAnalysis::addSymbol(SymbolID id, bool terminal)
+{
+    if (id >= this->termIndex.size()) {
+        this->termIndex.resize(id + 1, NONE);
+        this->nonTermIndex.resize(id + 1, NONE);
+    }
+    if (NONE != this->termIndex[id] || NONE != this->nonTermIndex[id]) return;
+    if (terminal) {
+        this->termIndex[id] = this->terms.size();
+        this->terms.push_back(id);
+    }
+    else {
+        this->nonTermIndex[id] = this->nonTerms.size();
+        this->nonTerms.push_back(id);
+        this->nullBits.grow(1, this->nonTerms.size());
+    }
+    this->firstBits.grow(this->nonTerms.size(), this->terms.size());
+    this->followBits.grow(this->nonTerms.size(), this->terms.size());
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+GrammarAnalysis::buildRegion(const CFGProductions &productions,
+                             const ProductionIndex &index,
+                             const vector<uint32_t> &seeds,
+                             bool dependents,
+                             vector<uint32_t> &region)
+{
+    this->stamps.resize(this->nonTerms.size(), 0);
+    this->locals.resize(this->nonTerms.size(), 0);
+    /* stamps from a previous lap could pass for this one */
+    if (0 == ++this->epoch) {
+        fill(this->stamps.begin(), this->stamps.end(), 0);
+        this->epoch = 1;
+    }
+    region.clear();
+    auto add = [&](uint32_t nt) {
+        if (NONE == nt || this->inRegion(nt)) return;
+        this->stamps[nt] = this->epoch;
+        this->locals[nt] = region.size();
+        region.push_back(nt);
+    };
+    for (uint32_t nt : seeds) add(nt);
+    for (size_t i = 0; i < region.size(); ++i) {
+        SymbolID id = this->nonTerms[region[i]];
+        if (dependents) {
+            for (uint32_t p : index.byRHS(id)) {
+                add(this->nonTermIndex[productions.lhs(p)]);
+            }
+            continue;
+        }
+        for (uint32_t p : index.byLHS(id)) {
+            const SymbolID *rend = productions.rhsEnd(p);
+            for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+                add(this->nonTermIndex[*s]);
+            }
+        }
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the same counting worklist as computeNullable(), over the productions of the
+ * region only. */
+vector<uint32_t>
+GrammarAnalysis::updateNullable(const CFGProductions &productions,
+                                const ProductionIndex &index,
+                                const vector<uint32_t> &region)
+{
+    vector<bool> old(region.size());
+    unordered_map<uint32_t, uint32_t> remaining;
+    vector<uint32_t> ready, work, changed;
+
+    for (size_t i = 0; i < region.size(); ++i) {
+        old[i] = this->nullBits.test(0, region[i]);
+        this->nullBits.reset(0, region[i]);
+    }
+    for (uint32_t lhs : region) {
+        for (uint32_t p : index.byLHS(this->nonTerms[lhs])) {
+            uint32_t unknown = 0;
+            bool terminal = false;
+            const SymbolID *rend = productions.rhsEnd(p);
+            for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+                uint32_t nt = this->nonTermIndex[*s];
+                if (NONE == nt) { terminal = true; break; }
+                if (!this->nullBits.test(0, nt)) ++unknown;
+            }
+            if (terminal) continue;
+            if (0 == unknown) ready.push_back(lhs);
+            else remaining[p] = unknown;
+        }
+    }
+    for (uint32_t nt : ready) {
+        if (this->nullBits.test(0, nt)) continue;
+        this->nullBits.set(0, nt);
+        work.push_back(nt);
+    }
+    while (!work.empty()) {
+        uint32_t nt = work.back(); work.pop_back();
+        for (uint32_t p : index.byRHS(this->nonTerms[nt])) {
+            ++this->nvisits;
+            auto r = remaining.find(p);
+            if (remaining.end() == r || 0 != --r->second) continue;
+            uint32_t lhs = this->nonTermIndex[productions.lhs(p)];
+            if (!this->nullBits.test(0, lhs)) {
+                this->nullBits.set(0, lhs);
+                work.push_back(lhs);
+            }
+        }
+    }
+    for (size_t i = 0; i < region.size(); ++i) {
+        if (old[i] != this->nullBits.test(0, region[i])) {
+            changed.push_back(region[i]);
+        }
+    }
+    return changed;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* writes local's rows back over the region's rows in m. returns the rows that
+ * changed. */
+static vector<uint32_t>
+storeRegion(BitMatrix &m,
+            const BitMatrix &local,
+            const vector<uint32_t> &region)
+{
+    size_t nwords = m.words();
+    vector<uint32_t> changed;
+
+    for (size_t i = 0; i < region.size(); ++i) {
+        uint64_t *row = m.row(region[i]);
+        if (!equal(row, row + nwords, local.row(i))) {
+            copy(local.row(i), local.row(i) + nwords, row);
+            changed.push_back(region[i]);
+        }
+    }
+    return changed;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* computeFirstSets() restricted to the region: a right-hand side non-terminal
+ * outside of it is already final, so its row is merged in up front instead of
+ * becoming an edge. */
+vector<uint32_t>
+GrammarAnalysis::updateFirstSets(const CFGProductions &productions,
+                                 const ProductionIndex &index,
+                                 const vector<uint32_t> &region)
+{
+    size_t nwords = this->firstBits.words();
+    vector< pair<uint32_t, uint32_t> > edges;
+    BitMatrix local;
+    Digraph g;
+
+    local.resize(region.size(), nwords * 64);
+    for (size_t i = 0; i < region.size(); ++i) {
+        for (uint32_t p : index.byLHS(this->nonTerms[region[i]])) {
+            const SymbolID *rend = productions.rhsEnd(p);
+            for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+                uint32_t t = this->termIndex[*s];
+                if (NONE != t) {
+                    local.set(i, t);
+                    break;
+                }
+                uint32_t nt = this->nonTermIndex[*s];
+                if (this->inRegion(nt)) {
+                    edges.push_back(make_pair(i, this->locals[nt]));
+                }
+                else {
+                    BitMatrix::merge(local.row(i), this->firstBits.row(nt),
+                                     nwords);
+                }
+                if (!this->nullBits.test(0, nt)) break;
+            }
+        }
+    }
+    g.build(region.size(), edges);
+    this->nedges += g.edges();
+    this->nvisits += g.closure(local);
+    return storeRegion(this->firstBits, local, region);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* computeFollowSets() restricted to the region, walking only the productions
+ * that a region member occurs in. */
+vector<uint32_t>
+GrammarAnalysis::updateFollowSets(const CFGProductions &productions,
+                                  const ProductionIndex &index,
+                                  const vector<uint32_t> &region)
+{
+    size_t nwords = this->followBits.words();
+    vector< pair<uint32_t, uint32_t> > edges;
+    vector<uint64_t> fob(nwords);
+    BitMatrix local;
+    Digraph g;
+
+    local.resize(region.size(), nwords * 64);
+    for (size_t i = 0; i < region.size(); ++i) {
+        SymbolID id = this->nonTerms[region[i]];
+        if (SymbolTable::START == id) {
+            local.set(i, this->termIndex[SymbolTable::END]);
+        }
+        for (uint32_t p : index.byRHS(id)) {
+            uint32_t lhs = this->nonTermIndex[productions.lhs(p)];
+            const SymbolID *rbegin = productions.rhsBegin(p);
+            bool betaNullable = true;
+            fill(fob.begin(), fob.end(), 0);
+            for (auto s = productions.rhsEnd(p); rbegin != s;) {
+                --s;
+                uint32_t t = this->termIndex[*s];
+                if (NONE != t) {
+                    fill(fob.begin(), fob.end(), 0);
+                    fob[t >> 6] |= uint64_t(1) << (t & 63);
+                    betaNullable = false;
+                    continue;
+                }
+                uint32_t nt = this->nonTermIndex[*s];
+                if (id == *s) {
+                    BitMatrix::merge(local.row(i), fob.data(), nwords);
+                    if (betaNullable && this->inRegion(lhs)) {
+                        edges.push_back(make_pair(i, this->locals[lhs]));
+                    }
+                    else if (betaNullable) {
+                        BitMatrix::merge(local.row(i),
+                                         this->followBits.row(lhs), nwords);
+                    }
+                }
+                if (!this->nullBits.test(0, nt)) {
+                    fill(fob.begin(), fob.end(), 0);
+                    betaNullable = false;
+                }
+                BitMatrix::merge(fob.data(), this->firstBits.row(nt), nwords);
+            }
+        }
+    }
+    g.build(region.size(), edges);
+    this->nedges += g.edges();
+    this->nvisits += g.closure(local);
+    return storeRegion(this->followBits, local, region);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* nullable depends on the productions of the edited non-terminals, FIRST
+ * depends on those and on whatever turned nullable, and FOLLOW depends on
+ * whatever occurs next to something whose FIRST or nullable changed. each
+ * region is closed over its own dependency relation, so everything outside of
+ * it is already final. */
+vector<SymbolID>
+GrammarAnalysis::update(const CFGProductions &productions,
+                        const ProductionIndex &index,
+                        const vector<SymbolID> &lhss,
+                        const vector<SymbolID> &rhss)
+{
+    vector<uint32_t> seeds, region, nulls, firsts, follows, rows;
+    vector<SymbolID> res;
+
+    for (SymbolID id : lhss) seeds.push_back(this->nonTerminalIndex(id));
+    this->buildRegion(productions, index, seeds, true, region);
+    nulls = this->updateNullable(productions, index, region);
+
+    seeds.insert(seeds.end(), nulls.begin(), nulls.end());
+    this->buildRegion(productions, index, seeds, true, region);
+    firsts = this->updateFirstSets(productions, index, region);
+
+    /* everything next to a changed non-terminal */
+    vector<uint32_t> changed(nulls);
+    changed.insert(changed.end(), firsts.begin(), firsts.end());
+    seeds.clear();
+    for (SymbolID id : rhss) seeds.push_back(this->nonTerminalIndex(id));
+    for (uint32_t nt : changed) {
+        for (uint32_t p : index.byRHS(this->nonTerms[nt])) {
+            const SymbolID *rend = productions.rhsEnd(p);
+            for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+                seeds.push_back(this->nonTermIndex[*s]);
+            }
+        }
+    }
+    this->buildRegion(productions, index, seeds, false, region);
+    follows = this->updateFollowSets(productions, index, region);
+
+    /* a table row is built from its non-terminal's productions, FIRST and
+     * nullable of their right-hand sides, and its FOLLOW set. */
+    for (SymbolID id : lhss) rows.push_back(this->nonTerminalIndex(id));
+    rows.insert(rows.end(), follows.begin(), follows.end());
+    for (uint32_t nt : changed) {
+        for (uint32_t p : index.byRHS(this->nonTerms[nt])) {
+            rows.push_back(this->nonTermIndex[productions.lhs(p)]);
+        }
+    }
+    sort(rows.begin(), rows.end());
+    rows.erase(unique(rows.begin(), rows.end()), rows.end());
+    for (uint32_t nt : rows) {
+        if (NONE != nt) res.push_back(this->nonTerms[nt]);
+    }
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+GrammarAnalysis::inFirst(SymbolID id, SymbolID t) const
+{
+    uint32_t ti = this->terminalIndex(t);
+    if (NONE == ti) return false;
+    if (NONE != this->terminalIndex(id)) return id == t;
+    uint32_t nt = this->nonTerminalIndex(id);
+    return NONE != nt && this->firstBits.test(nt, ti);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+GrammarAnalysis::inFollow(SymbolID id, SymbolID t) const
+{
+    uint32_t ti = this->terminalIndex(t);
+    uint32_t nt = this->nonTerminalIndex(id);
+    return NONE != ti && NONE != nt && this->followBits.test(nt, ti);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+GrammarAnalysis::predict(const CFGProductions &productions,
+                         size_t p,
+                         vector<uint64_t> &out) const
+{
+    size_t nwords = this->firstBits.words();
+    const SymbolID *rend = productions.rhsEnd(p);
+
+    out.assign(nwords, 0);
+    for (auto s = productions.rhsBegin(p); rend != s; ++s) {
+        uint32_t t = this->termIndex[*s];
+        if (NONE != t) {
+            out[t >> 6] |= uint64_t(1) << (t & 63);
+            return;
+        }
+        uint32_t nt = this->nonTermIndex[*s];
+        BitMatrix::merge(out.data(), this->firstBits.row(nt), nwords);
+        if (!this->nullBits.test(0, nt)) return;
+    }
+    uint32_t lhs = this->nonTermIndex[productions.lhs(p)];
+    BitMatrix::merge(out.data(), this->followBits.row(lhs), nwords);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static vector<SymbolID>
+rowMembers(const BitMatrix &m,
+           uint32_t r,
+           const vector<SymbolID> &terms)
+{
+    vector<SymbolID> res;
+
+    for (uint32_t t = 0; t < terms.size(); ++t) {
+        if (m.test(r, t)) res.push_back(terms[t]);
+    }
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+vector<SymbolID>
+GrammarAnalysis::firsts(SymbolID id) const
+{
+    if (NONE != this->terminalIndex(id)) return vector<SymbolID>(1, id);
+    uint32_t nt = this->nonTerminalIndex(id);
+    if (NONE == nt) return vector<SymbolID>();
+    return rowMembers(this->firstBits, nt, this->terms);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+vector<SymbolID>
+GrammarAnalysis::follows(SymbolID id) const
+{
+    uint32_t nt = this->nonTerminalIndex(id);
+    if (NONE == nt) return vector<SymbolID>();
+    return rowMembers(this->followBits, nt, this->terms);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+size_t
+GrammarAnalysis::bytes(void) const
+{
+    return this->nullBits.bytes() + this->firstBits.bytes() +
+           this->followBits.bytes();
+}
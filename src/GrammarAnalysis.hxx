@@ -0,0 +1,335 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GRAMMAR_ANALYSIS_H_INCLUDED
+#define GRAMMAR_ANALYSIS_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "Symbol.hxx"
+
+#include <vector>
+#include <utility>
+
+#include <stdint.h>
+
+class CFGProductions;
+class ThreadPool;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* bit matrix class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* rows of packed bits. every row is words() 64-bit words wide, so unions are
+ * word-wide (or wider) ors. */
+class BitMatrix {
+private:
+    /* number of 64-bit words per row */
+    size_t nwords;
+    /* all the rows, back-to-back */
+    std::vector<uint64_t> bits;
+
+public:
+    BitMatrix(void) : nwords(0) { ; }
+
+    ~BitMatrix(void) { ; }
+
+    void resize(size_t rows, size_t cols);
+
+    /* like resize(), but keeps what is already there */
+    void grow(size_t rows, size_t cols);
+
+    size_t rows(void) const {
+        return 0 == this->nwords ? 0 : this->bits.size() / this->nwords;
+    }
+
+    size_t words(void) const { return this->nwords; }
+
+    uint64_t *row(size_t r) { return this->bits.data() + r * this->nwords; }
+
+    const uint64_t *row(size_t r) const {
+        return this->bits.data() + r * this->nwords;
+    }
+
+    bool test(size_t r, size_t c) const {
+        return (this->row(r)[c >> 6] >> (c & 63)) & 1;
+    }
+
+    void set(size_t r, size_t c) {
+        this->row(r)[c >> 6] |= uint64_t(1) << (c & 63);
+    }
+
+    void reset(size_t r, size_t c) {
+        this->row(r)[c >> 6] &= ~(uint64_t(1) << (c & 63));
+    }
+
+    size_t bytes(void) const { return this->bits.size() * sizeof(uint64_t); }
+
+    /* dst |= src. returns whether or not dst changed. */
+    static bool merge(uint64_t *dst, const uint64_t *src, size_t nwords);
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* digraph class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a relation over dense node ids, stored in compressed sparse row form. */
+class Digraph {
+private:
+    /* start of each node's successors in targets (nodes() + 1) */
+    std::vector<uint32_t> offsets;
+    /* all successors, back-to-back */
+    std::vector<uint32_t> targets;
+    /* the traversal shared by both closure() flavors. merges rows of F along
+     * the way when F is given. numbers components in completion order and
+     * computes their level in the condensation when comp is given. */
+    size_t traverse(BitMatrix *F,
+                    std::vector<uint32_t> *comp,
+                    std::vector<uint32_t> *level) const;
+
+public:
+    Digraph(void) : offsets(1, 0) { ; }
+
+    ~Digraph(void) { ; }
+
+    /* builds the graph from a list of (from, to) edges */
+    void build(size_t nnodes,
+               const std::vector< std::pair<uint32_t, uint32_t> > &edges);
+
+    size_t nodes(void) const { return this->offsets.size() - 1; }
+
+    size_t edges(void) const { return this->targets.size(); }
+
+    const uint32_t *succBegin(uint32_t v) const {
+        return this->targets.data() + this->offsets[v];
+    }
+
+    const uint32_t *succEnd(uint32_t v) const {
+        return this->targets.data() + this->offsets[v + 1];
+    }
+
+    /* DeRemer and Pennello's digraph algorithm: on return, row x of F is the
+     * union of its initial value and the initial values of every node
+     * reachable from x. strongly connected components are collapsed as they
+     * are found, so every edge is visited exactly once. returns the number of
+     * edge visits. */
+    size_t closure(BitMatrix &F) const;
+
+    /* same result as closure(F), but on a thread pool: components are found
+     * first and then every level of the condensation is merged in parallel,
+     * so every edge is visited exactly twice. */
+    size_t closure(BitMatrix &F, ThreadPool &pool) const;
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* production index class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* productions by symbol id, kept current across grammar edits. a production
+ * is listed under its left-hand side once and under a right-hand side symbol
+ * once for every occurrence. */
+class ProductionIndex {
+private:
+    std::vector< std::vector<uint32_t> > lhsProds;
+    std::vector< std::vector<uint32_t> > rhsProds;
+    /* replaces one from in list with to */
+    static void relist(std::vector<uint32_t> &list, uint32_t from, uint32_t to);
+    /* drops one p from list */
+    static void unlist(std::vector<uint32_t> &list, uint32_t p);
+
+public:
+    ProductionIndex(void) { ; }
+
+    ~ProductionIndex(void) { ; }
+
+    bool empty(void) const { return this->lhsProds.empty(); }
+
+    /* does id appear in any production? */
+    bool occurs(SymbolID id) const {
+        return id < this->lhsProds.size() &&
+               (!this->lhsProds[id].empty() || !this->rhsProds[id].empty());
+    }
+
+    void build(size_t nsymbols, const CFGProductions &productions);
+
+    /* production p was just appended */
+    void add(const CFGProductions &productions, uint32_t p);
+
+    /* production p is about to be removed */
+    void remove(const CFGProductions &productions, uint32_t p);
+
+    /* production from is about to become production to */
+    void move(const CFGProductions &productions, uint32_t from, uint32_t to);
+
+    const std::vector<uint32_t> &byLHS(SymbolID id) const {
+        return this->lhsProds[id];
+    }
+
+    const std::vector<uint32_t> &byRHS(SymbolID id) const {
+        return this->rhsProds[id];
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* grammar analysis class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* nullable, FIRST, and FOLLOW -- stored once per non-terminal as bit rows over
+ * the terminal alphabet. terminals are numbered densely in column order and
+ * non-terminals densely in row order. */
+class GrammarAnalysis {
+private:
+    /* dense terminal (column) index of each symbol id, NONE if non-terminal */
+    std::vector<uint32_t> termIndex;
+    /* dense non-terminal (row) index of each symbol id, NONE if terminal */
+    std::vector<uint32_t> nonTermIndex;
+    /* column to symbol id */
+    std::vector<SymbolID> terms;
+    /* row to symbol id */
+    std::vector<SymbolID> nonTerms;
+    /* single row, one bit per non-terminal */
+    BitMatrix nullBits;
+    /* one row per non-terminal */
+    BitMatrix firstBits;
+    /* one row per non-terminal */
+    BitMatrix followBits;
+    /* number of dependency edges built by the solvers */
+    size_t nedges;
+    /* number of times the solvers walked a dependency edge */
+    size_t nvisits;
+    /* bumped whenever init() renumbers rows and columns */
+    size_t nlayouts;
+    /* update() scratch: region membership stamps and local row numbers */
+    std::vector<uint32_t> stamps;
+    std::vector<uint32_t> locals;
+    uint32_t epoch;
+    /* starts a region from seeds (non-terminal rows) and grows it until it
+     * holds every non-terminal that depends on one of its members -- through a
+     * right-hand side occurrence when dependents is set, and through a member's
+     * right-hand side otherwise. region[locals[nt]] == nt. */
+    void buildRegion(const CFGProductions &productions,
+                     const ProductionIndex &index,
+                     const std::vector<uint32_t> &seeds,
+                     bool dependents,
+                     std::vector<uint32_t> &region);
+
+    bool inRegion(uint32_t nt) const {
+        return this->epoch == this->stamps[nt];
+    }
+
+    /* the update*() routines recompute a region's sets from scratch against
+     * the unchanged sets outside of it and return the rows that changed */
+    std::vector<uint32_t>
+    updateNullable(const CFGProductions &productions,
+                   const ProductionIndex &index,
+                   const std::vector<uint32_t> &region);
+
+    std::vector<uint32_t>
+    updateFirstSets(const CFGProductions &productions,
+                    const ProductionIndex &index,
+                    const std::vector<uint32_t> &region);
+
+    std::vector<uint32_t>
+    updateFollowSets(const CFGProductions &productions,
+                     const ProductionIndex &index,
+                     const std::vector<uint32_t> &region);
+
+public:
+    /* nothing. initialized here so that the strong driver needs no
+     * definition to link against. */
+    static const uint32_t NONE = UINT32_MAX;
+
+    GrammarAnalysis(void) : nedges(0), nvisits(0), nlayouts(0), epoch(0) { ; }
+
+    ~GrammarAnalysis(void) { ; }
+
+    /* sizes everything for the symbols that appear in productions */
+    void init(const SymbolTable &symbols, const CFGProductions &productions);
+
+    void computeNullable(const CFGProductions &productions);
+
+    void computeFirstSets(const CFGProductions &productions,
+                          ThreadPool *pool = NULL);
+
+    void computeFollowSets(const CFGProductions &productions,
+                           ThreadPool *pool = NULL);
+
+    /* makes room for a symbol that just started appearing in productions */
+    void addSymbol(SymbolID id, bool terminal);
+
+    /* brings nullable, FIRST, and FOLLOW up to date after the productions of
+     * the non-terminals in lhss changed. rhss holds the right-hand side
+     * symbols of the productions that came or went. only the sets that could
+     * depend on the edit are recomputed. returns the non-terminals whose
+     * LL(1) table rows may no longer be the same. */
+    std::vector<SymbolID> update(const CFGProductions &productions,
+                                 const ProductionIndex &index,
+                                 const std::vector<SymbolID> &lhss,
+                                 const std::vector<SymbolID> &rhss);
+
+    const std::vector<SymbolID> &terminals(void) const { return this->terms; }
+
+    const std::vector<SymbolID> &nonTerminals(void) const {
+        return this->nonTerms;
+    }
+
+    uint32_t terminalIndex(SymbolID id) const {
+        return id < this->termIndex.size() ? this->termIndex[id] : NONE;
+    }
+
+    uint32_t nonTerminalIndex(SymbolID id) const {
+        return id < this->nonTermIndex.size() ? this->nonTermIndex[id] : NONE;
+    }
+
+    bool nullable(SymbolID id) const {
+        uint32_t nt = this->nonTerminalIndex(id);
+        return NONE != nt && this->nullBits.test(0, nt);
+    }
+
+    /* is terminal t in FIRST(id)? */
+    bool inFirst(SymbolID id, SymbolID t) const;
+
+    /* is terminal t in FOLLOW(id)? */
+    bool inFollow(SymbolID id, SymbolID t) const;
+
+    /* PREDICT(p): FIRST of p's right-hand side, plus FOLLOW of its left-hand
+     * side when the right-hand side is nullable. out gets one bit per
+     * terminal column. */
+    void predict(const CFGProductions &productions,
+                 size_t p,
+                 std::vector<uint64_t> &out) const;
+
+    const BitMatrix &firstSets(void) const { return this->firstBits; }
+
+    const BitMatrix &followSets(void) const { return this->followBits; }
+
+    std::vector<SymbolID> firsts(SymbolID id) const;
+
+    std::vector<SymbolID> follows(SymbolID id) const;
+
+    size_t bytes(void) const;
+
+    /* every edge is visited a bounded number of times: edgeVisits() never
+     * exceeds edges(), or twice that when running on a thread pool */
+    size_t edges(void) const { return this->nedges; }
+
+    size_t edgeVisits(void) const { return this->nvisits; }
+
+    /* addSymbol() only ever appends rows and columns, so anything laid out
+     * after the analysis stays valid for as long as this does not change */
+    size_t layout(void) const { return this->nlayouts; }
+};
+
+#endif
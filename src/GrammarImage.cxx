@@ -0,0 +1,601 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "GrammarImage.hxx"
+#include "Constants.hxx"
+#include "DialectException.hxx"
+#include "CFG.hxx"
+
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+const char GrammarImage::MAGIC[8] = {'D', 'I', 'A', 'L', 'E', 'C', 'T', '\0'};
+const uint32_t GrammarImage::FORMAT_VERSION = 4;
+
+/* reads back as something else on a machine with the other byte order */
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+/* image sections, in file order */
+enum {
+    /* uint32_t [nsymbols + 1] into NAMES */
+    SEC_NAME_OFFSETS = 0,
+    /* char [nameBytes] */
+    SEC_NAMES,
+    /* uint8_t [nsymbols], 1 for terminals */
+    SEC_KINDS,
+    /* uint32_t [nsymbols] each, GrammarAnalysis::NONE where not applicable */
+    SEC_TERM_INDEX,
+    SEC_NON_TERM_INDEX,
+    /* SymbolID [nprods] */
+    SEC_LHSS,
+    /* uint32_t [nprods + 1] into RHSS */
+    SEC_RHS_OFFSETS,
+    /* SymbolID [nrhs] each. the second has every right-hand side reversed,
+     * ready to be pushed onto a parse stack. */
+    SEC_RHSS,
+    SEC_REVERSED_RHSS,
+    /* uint64_t [(nnonterms + 63) / 64] */
+    SEC_NULLABLE,
+    /* uint64_t [nnonterms * nwords] each */
+    SEC_FIRST,
+    SEC_FOLLOW,
+    /* SymbolID [256] */
+    SEC_BYTE_TERMINALS,
+    /* uint32_t [nnonterms] */
+    SEC_BASE,
+    /* PackedSlot [nslots] */
+    SEC_SLOTS,
+    /* the lexer, empty when there is none. uint8_t [256] when there is,
+     * uint32_t [nlexstates * nlexclasses], and SymbolID [nlexstates]. */
+    SEC_LEX_CLASSES,
+    SEC_LEX_MOVES,
+    SEC_LEX_ACCEPTS,
+    /* the productions as written, empty unless the grammar was rewritten.
+     * uint32_t [nprods] into them, CFGProductions::NONE for productions
+     * none of them accounts for, then SymbolID [norigs], uint32_t
+     * [norigs + 1] into ORIG_RHSS, and SymbolID [norigrhs]. */
+    SEC_ORIGINS,
+    SEC_ORIG_LHSS,
+    SEC_ORIG_RHS_OFFSETS,
+    SEC_ORIG_RHSS,
+    SEC_COUNT
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the header every image starts with. fixed-width fields only. */
+struct ImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    /* of the whole image */
+    uint64_t size;
+    uint32_t nsymbols;
+    uint32_t nnonterms;
+    uint32_t nprods;
+    uint32_t nrhs;
+    uint32_t nameBytes;
+    /* words per FIRST and FOLLOW row */
+    uint32_t nwords;
+    uint32_t nslots;
+    uint32_t strong;
+    uint32_t nlexstates;
+    uint32_t nlexclasses;
+    uint32_t norigs;
+    uint32_t norigrhs;
+    /* from the start of the image */
+    uint64_t offsets[SEC_COUNT];
+    uint64_t lengths[SEC_COUNT];
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+class GrammarImage::Storage {
+public:
+    /* uint64_t keeps heap images 8-byte aligned */
+    vector<uint64_t> heap;
+    void *map;
+    size_t mapBytes;
+
+    Storage(void) : map(NULL), mapBytes(0) { ; }
+
+    ~Storage(void) {
+#ifdef HAVE_SYS_MMAN_H
+        if (NULL != this->map) munmap(this->map, this->mapBytes);
+#endif
+    }
+
+    const char *data(void) const {
+        if (NULL != this->map) return static_cast<const char *>(this->map);
+        return reinterpret_cast<const char *>(this->heap.data());
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* what the header's counts say section s must hold */
+static uint64_t
+sectionBytes(const ImageHeader &h, int s)
+{
+    uint64_t rowBytes = uint64_t(h.nnonterms) * h.nwords * sizeof(uint64_t);
+
+    switch (s) {
+        case SEC_NAME_OFFSETS:
+            return (uint64_t(h.nsymbols) + 1) * sizeof(uint32_t);
+        case SEC_NAMES:
+            return h.nameBytes;
+        case SEC_KINDS:
+            return h.nsymbols;
+        case SEC_TERM_INDEX:
+        case SEC_NON_TERM_INDEX:
+            return uint64_t(h.nsymbols) * sizeof(uint32_t);
+        case SEC_LHSS:
+            return uint64_t(h.nprods) * sizeof(SymbolID);
+        case SEC_RHS_OFFSETS:
+            return (uint64_t(h.nprods) + 1) * sizeof(uint32_t);
+        case SEC_RHSS:
+        case SEC_REVERSED_RHSS:
+            return uint64_t(h.nrhs) * sizeof(SymbolID);
+        case SEC_NULLABLE:
+            return (uint64_t(h.nnonterms) + 63) / 64 * sizeof(uint64_t);
+        case SEC_FIRST:
+        case SEC_FOLLOW:
+            return rowBytes;
+        case SEC_BYTE_TERMINALS:
+            return 256 * sizeof(SymbolID);
+        case SEC_BASE:
+            return uint64_t(h.nnonterms) * sizeof(uint32_t);
+        case SEC_SLOTS:
+            return uint64_t(h.nslots) * sizeof(PackedSlot);
+        case SEC_LEX_CLASSES:
+            return 0 == h.nlexstates ? 0 : 256;
+        case SEC_LEX_MOVES:
+            return uint64_t(h.nlexstates) * h.nlexclasses * sizeof(uint32_t);
+        case SEC_LEX_ACCEPTS:
+            return uint64_t(h.nlexstates) * sizeof(SymbolID);
+        case SEC_ORIGINS:
+            return 0 == h.norigs ? 0 : uint64_t(h.nprods) * sizeof(uint32_t);
+        case SEC_ORIG_LHSS:
+            return uint64_t(h.norigs) * sizeof(SymbolID);
+        case SEC_ORIG_RHS_OFFSETS:
+            return 0 == h.norigs ? 0 :
+                   (uint64_t(h.norigs) + 1) * sizeof(uint32_t);
+        case SEC_ORIG_RHSS:
+            return uint64_t(h.norigrhs) * sizeof(SymbolID);
+        default:
+            return 0;
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static uint64_t
+align8(uint64_t n)
+{
+    return (n + 7) & ~uint64_t(7);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename T>
+static T *
+section(char *image, const ImageHeader &h, int s)
+{
+    return reinterpret_cast<T *>(image + h.offsets[s]);
+}
+
+template <typename T>
+static const T *
+section(const char *image, const ImageHeader &h, int s)
+{
+    return reinterpret_cast<const T *>(image + h.offsets[s]);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+GrammarImage::GrammarImage(void) : image(NULL),
+                                   nbytes(0),
+                                   nsymbols(0),
+                                   nprods(0),
+                                   nwords(0),
+                                   isStrong(false),
+                                   norigs(0)
+{
+    ;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+GrammarImage::build(const CFG &cfg, const PackedParseTable &table, bool strong)
+{
+    const SymbolTable &symbols = cfg.symbols();
+    const CFGProductions &prods = cfg.prods();
+    const GrammarAnalysis &ga = cfg.analysis();
+    const vector<SymbolID> &nonTerms = ga.nonTerminals();
+    LexerTables lexTables(cfg.tokens(), symbols);
+    Lexer lexer = lexTables.lexer();
+    ImageHeader h;
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MAGIC, sizeof(h.magic));
+    h.version = FORMAT_VERSION;
+    h.byteOrder = BYTE_ORDER_MARK;
+    h.nsymbols = symbols.size();
+    h.nnonterms = nonTerms.size();
+    h.nprods = prods.size();
+    for (size_t p = 0; p < prods.size(); ++p) h.nrhs += prods.rhsLength(p);
+    for (SymbolID id = 0; id < symbols.size(); ++id) {
+        h.nameBytes += symbols.name(id).size();
+    }
+    h.nwords = ga.firstSets().words();
+    h.nslots = table.comb().size();
+    h.strong = strong;
+    h.nlexstates = lexer.states();
+    h.nlexclasses = lexer.classCount();
+    if (cfg.rewritten()) {
+        const CFGProductions &origs = cfg.originals();
+        h.norigs = origs.size();
+        for (size_t o = 0; o < origs.size(); ++o) {
+            h.norigrhs += origs.rhsLength(o);
+        }
+    }
+    uint64_t off = align8(sizeof(h));
+    for (int s = 0; s < SEC_COUNT; ++s) {
+        h.offsets[s] = off;
+        h.lengths[s] = sectionBytes(h, s);
+        off = align8(off + h.lengths[s]);
+    }
+    h.size = off;
+
+    shared_ptr<Storage> st(new Storage());
+    st->heap.assign(h.size / sizeof(uint64_t), 0);
+    char *img = reinterpret_cast<char *>(st->heap.data());
+    memcpy(img, &h, sizeof(h));
+    /* symbols */
+    uint32_t *nameOffs = section<uint32_t>(img, h, SEC_NAME_OFFSETS);
+    char *nameChars = section<char>(img, h, SEC_NAMES);
+    uint8_t *kindFlags = section<uint8_t>(img, h, SEC_KINDS);
+    uint32_t *tIndex = section<uint32_t>(img, h, SEC_TERM_INDEX);
+    uint32_t *ntIndex = section<uint32_t>(img, h, SEC_NON_TERM_INDEX);
+    nameOffs[0] = 0;
+    for (SymbolID id = 0; id < h.nsymbols; ++id) {
+        const string &n = symbols.name(id);
+        memcpy(nameChars + nameOffs[id], n.data(), n.size());
+        nameOffs[id + 1] = nameOffs[id] + n.size();
+        kindFlags[id] = symbols.terminal(id);
+        tIndex[id] = ga.terminalIndex(id);
+        ntIndex[id] = ga.nonTerminalIndex(id);
+    }
+    /* productions, without the holes edits leave behind */
+    SymbolID *lhsIDs = section<SymbolID>(img, h, SEC_LHSS);
+    uint32_t *rhsOffs = section<uint32_t>(img, h, SEC_RHS_OFFSETS);
+    SymbolID *rhsIDs = section<SymbolID>(img, h, SEC_RHSS);
+    SymbolID *reversedIDs = section<SymbolID>(img, h, SEC_REVERSED_RHSS);
+    rhsOffs[0] = 0;
+    for (size_t p = 0; p < prods.size(); ++p) {
+        lhsIDs[p] = prods.lhs(p);
+        rhsOffs[p + 1] = rhsOffs[p] + prods.rhsLength(p);
+        copy(prods.rhsBegin(p), prods.rhsEnd(p), rhsIDs + rhsOffs[p]);
+        reverse_copy(prods.rhsBegin(p), prods.rhsEnd(p),
+                     reversedIDs + rhsOffs[p]);
+    }
+    /* analysis */
+    uint64_t *nulls = section<uint64_t>(img, h, SEC_NULLABLE);
+    for (size_t r = 0; r < nonTerms.size(); ++r) {
+        if (ga.nullable(nonTerms[r])) nulls[r >> 6] |= uint64_t(1) << (r & 63);
+    }
+    if (0 != h.lengths[SEC_FIRST]) {
+        memcpy(section<uint64_t>(img, h, SEC_FIRST), ga.firstSets().row(0),
+               h.lengths[SEC_FIRST]);
+        memcpy(section<uint64_t>(img, h, SEC_FOLLOW), ga.followSets().row(0),
+               h.lengths[SEC_FOLLOW]);
+    }
+    /* input bytes and the parse table */
+    symbols.byteTerminals(section<SymbolID>(img, h, SEC_BYTE_TERMINALS));
+    const vector<uint32_t> &bases = table.displacements();
+    copy(bases.begin(), bases.end(), section<uint32_t>(img, h, SEC_BASE));
+    const vector<PackedSlot> &comb = table.comb();
+    copy(comb.begin(), comb.end(), section<PackedSlot>(img, h, SEC_SLOTS));
+    /* the lexer */
+    if (!lexer.empty()) {
+        memcpy(section<uint8_t>(img, h, SEC_LEX_CLASSES), lexer.byteClasses(),
+               h.lengths[SEC_LEX_CLASSES]);
+        memcpy(section<uint32_t>(img, h, SEC_LEX_MOVES), lexer.stateMoves(),
+               h.lengths[SEC_LEX_MOVES]);
+        memcpy(section<SymbolID>(img, h, SEC_LEX_ACCEPTS),
+               lexer.stateAccepts(), h.lengths[SEC_LEX_ACCEPTS]);
+    }
+    /* where the productions came from */
+    if (0 != h.norigs) {
+        const CFGProductions &origs = cfg.originals();
+        uint32_t *from = section<uint32_t>(img, h, SEC_ORIGINS);
+        SymbolID *origLhsIDs = section<SymbolID>(img, h, SEC_ORIG_LHSS);
+        uint32_t *origOffs = section<uint32_t>(img, h, SEC_ORIG_RHS_OFFSETS);
+        SymbolID *origRhsIDs = section<SymbolID>(img, h, SEC_ORIG_RHSS);
+        for (size_t p = 0; p < prods.size(); ++p) from[p] = cfg.origin(p);
+        origOffs[0] = 0;
+        for (size_t o = 0; o < origs.size(); ++o) {
+            origLhsIDs[o] = origs.lhs(o);
+            origOffs[o + 1] = origOffs[o] + origs.rhsLength(o);
+            copy(origs.rhsBegin(o), origs.rhsEnd(o),
+                 origRhsIDs + origOffs[o]);
+        }
+    }
+
+    this->attach(st, h.size, "grammar image");
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* only the header is looked at. the sections are trusted, which is what lets
+ * a mapped image be used without touching any page it doesn't need. */
+void
+GrammarImage::attach(const shared_ptr<const Storage> &s,
+                     size_t size,
+                     const string &what)
+{
+    const char *img = s->data();
+    ImageHeader h;
+
+    if (size < sizeof(h.magic) || 0 != memcmp(img, MAGIC, sizeof(h.magic))) {
+        string estr = what + " is not a compiled grammar.";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    if (size < sizeof(h)) {
+        string estr = what + " is damaged or truncated.";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    memcpy(&h, img, sizeof(h));
+    if (BYTE_ORDER_MARK != h.byteOrder) {
+        string estr = what + " was compiled on a machine with a different "
+                      "byte order. please recompile it.";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    if (FORMAT_VERSION != h.version) {
+        string estr = what + " is a version " + to_string(h.version) +
+                      " compiled grammar, but this is version " +
+                      to_string(FORMAT_VERSION) + ". please recompile it.";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    bool ok = size == h.size && 0 != h.nnonterms && 0 != h.nprods;
+    for (int i = 0; ok && i < SEC_COUNT; ++i) {
+        ok = 0 == h.offsets[i] % 8 && h.offsets[i] >= sizeof(h) &&
+             h.lengths[i] == sectionBytes(h, i) &&
+             h.offsets[i] + h.lengths[i] <= size;
+    }
+    ok = ok && h.nameBytes ==
+               section<uint32_t>(img, h, SEC_NAME_OFFSETS)[h.nsymbols] &&
+               h.nrhs == section<uint32_t>(img, h, SEC_RHS_OFFSETS)[h.nprods];
+    ok = ok && (0 == h.norigs || h.norigrhs ==
+               section<uint32_t>(img, h, SEC_ORIG_RHS_OFFSETS)[h.norigs]);
+    if (!ok) {
+        string estr = what + " is damaged or truncated.";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    this->storage = s;
+    this->image = img;
+    this->nbytes = size;
+    this->nsymbols = h.nsymbols;
+    this->nprods = h.nprods;
+    this->nwords = h.nwords;
+    this->isStrong = 0 != h.strong;
+    this->nameOffsets = section<uint32_t>(img, h, SEC_NAME_OFFSETS);
+    this->names = section<char>(img, h, SEC_NAMES);
+    this->kinds = section<uint8_t>(img, h, SEC_KINDS);
+    this->termIndex = section<uint32_t>(img, h, SEC_TERM_INDEX);
+    this->nonTermIndex = section<uint32_t>(img, h, SEC_NON_TERM_INDEX);
+    this->lhss = section<SymbolID>(img, h, SEC_LHSS);
+    this->rhsOffsets = section<uint32_t>(img, h, SEC_RHS_OFFSETS);
+    this->rhss = section<SymbolID>(img, h, SEC_RHSS);
+    this->reversedRhss = section<SymbolID>(img, h, SEC_REVERSED_RHSS);
+    this->nullBits = section<uint64_t>(img, h, SEC_NULLABLE);
+    this->firstBits = section<uint64_t>(img, h, SEC_FIRST);
+    this->followBits = section<uint64_t>(img, h, SEC_FOLLOW);
+    this->byteTerms = section<SymbolID>(img, h, SEC_BYTE_TERMINALS);
+    this->base = section<uint32_t>(img, h, SEC_BASE);
+    this->slots = section<PackedSlot>(img, h, SEC_SLOTS);
+    this->norigs = h.norigs;
+    this->origins = section<uint32_t>(img, h, SEC_ORIGINS);
+    this->origLhss = section<SymbolID>(img, h, SEC_ORIG_LHSS);
+    this->origRhsOffsets = section<uint32_t>(img, h, SEC_ORIG_RHS_OFFSETS);
+    this->origRhss = section<SymbolID>(img, h, SEC_ORIG_RHSS);
+    this->lex = 0 == h.nlexstates ? Lexer() :
+                Lexer(h.nlexstates, h.nlexclasses,
+                      section<uint8_t>(img, h, SEC_LEX_CLASSES),
+                      section<uint32_t>(img, h, SEC_LEX_MOVES),
+                      section<SymbolID>(img, h, SEC_LEX_ACCEPTS));
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+GrammarImage::save(const string &path) const
+{
+    FILE *fp = NULL;
+
+    if (this->empty()) {
+        throw DialectException(DIALECT_WHERE, "nothing to save.");
+    }
+    if (NULL == (fp = fopen(path.c_str(), "wb"))) {
+        int err = errno;
+        string estr = "cannot open: " + path + ". why: " + strerror(err) + ".";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    size_t n = fwrite(this->image, 1, this->nbytes, fp);
+    int err = errno;
+    if (0 != fclose(fp) || n != this->nbytes) {
+        if (0 == err) err = errno;
+        string estr = "cannot write: " + path + ". why: " + strerror(err) + ".";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* mmap()ed read-only where we can, read into the heap otherwise */
+void
+GrammarImage::load(const string &path)
+{
+    shared_ptr<Storage> st(new Storage());
+    size_t size = 0;
+    int err = 0;
+
+#ifdef HAVE_SYS_MMAN_H
+    struct stat sb;
+    int fd = open(path.c_str(), O_RDONLY);
+    if (-1 == fd || -1 == fstat(fd, &sb)) err = errno;
+    else if (0 < sb.st_size) {
+        size = sb.st_size;
+        void *m = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED == m) err = errno;
+        else {
+            st->map = m;
+            st->mapBytes = size;
+        }
+    }
+    if (-1 != fd) close(fd);
+#else
+    FILE *fp = fopen(path.c_str(), "rb");
+    if (NULL == fp) err = errno;
+    else {
+        char buf[4096];
+        size_t n = 0;
+        while (0 < (n = fread(buf, 1, sizeof(buf), fp))) {
+            st->heap.resize((size + n + 7) / 8);
+            memcpy(reinterpret_cast<char *>(st->heap.data()) + size, buf, n);
+            size += n;
+        }
+        if (ferror(fp)) err = errno;
+        fclose(fp);
+    }
+#endif
+    if (0 != err) {
+        string estr = "cannot open: " + path + ". why: " + strerror(err) + ".";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    if (0 == size) {
+        string estr = path + " is not a compiled grammar.";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    this->attach(st, size, path);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+GrammarImage::sniff(const string &path)
+{
+    char magic[sizeof(MAGIC)];
+    FILE *fp = fopen(path.c_str(), "rb");
+
+    if (NULL == fp) return false;
+    bool res = sizeof(magic) == fread(magic, 1, sizeof(magic), fp) &&
+               0 == memcmp(magic, MAGIC, sizeof(magic));
+    fclose(fp);
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+string
+GrammarImage::name(SymbolID id) const
+{
+    /* NONE included */
+    if (id >= this->nsymbols) return SymbolTable::DEAD_NAME;
+    return string(this->names + this->nameOffsets[id],
+                  this->names + this->nameOffsets[id + 1]);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+string
+GrammarImage::str(size_t p) const
+{
+    string res = this->name(this->lhs(p)) + " --> ";
+
+    if (this->rhsBegin(p) == this->rhsEnd(p)) {
+        return res + SymbolTable::EPSILON_NAME;
+    }
+    for (auto s = this->rhsBegin(p); s != this->rhsEnd(p); ++s) {
+        res += this->name(*s);
+    }
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+string
+GrammarImage::originStr(size_t p) const
+{
+    if (0 == this->norigs) return "";
+    uint32_t o = this->origins[p];
+    if (CFGProductions::NONE == o) return "new";
+    string res = this->name(this->origLhss[o]) + " --> ";
+    const SymbolID *b = this->origRhss + this->origRhsOffsets[o];
+    const SymbolID *e = this->origRhss + this->origRhsOffsets[o + 1];
+    if (b == e) res += SymbolTable::EPSILON_NAME;
+    for (const SymbolID *s = b; s != e; ++s) res += this->name(*s);
+    return res == this->str(p) ? "" : "from " + res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* same answers as GrammarAnalysis::inFirst() */
+bool
+GrammarImage::inFirst(SymbolID id, SymbolID t) const
+{
+    uint32_t ti = this->terminalIndex(t);
+    if (GrammarAnalysis::NONE == ti) return false;
+    if (GrammarAnalysis::NONE != this->terminalIndex(id)) return id == t;
+    uint32_t nt = this->nonTerminalIndex(id);
+    if (GrammarAnalysis::NONE == nt) return false;
+    const uint64_t *row = this->firstBits + size_t(nt) * this->nwords;
+    return 0 != (row[ti >> 6] & (uint64_t(1) << (ti & 63)));
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+GrammarImage::inFollow(SymbolID id, SymbolID t) const
+{
+    uint32_t ti = this->terminalIndex(t);
+    uint32_t nt = this->nonTerminalIndex(id);
+    if (GrammarAnalysis::NONE == ti || GrammarAnalysis::NONE == nt) {
+        return false;
+    }
+    const uint64_t *row = this->followBits + size_t(nt) * this->nwords;
+    return 0 != (row[ti >> 6] & (uint64_t(1) << (ti & 63)));
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+vector<SymbolID>
+GrammarImage::expects(SymbolID id) const
+{
+    vector<SymbolID> res;
+
+    if (this->terminal(id)) return vector<SymbolID>(1, id);
+    bool followToo = this->nullable(id);
+    for (SymbolID t = 0; t < this->nsymbols; ++t) {
+        if (SymbolTable::END == t || !this->terminal(t)) continue;
+        if (this->inFirst(id, t) || (followToo && this->inFollow(id, t))) {
+            res.push_back(t);
+        }
+    }
+    if (followToo && this->inFollow(id, SymbolTable::END)) {
+        res.push_back(SymbolTable::END);
+    }
+    return res;
+}
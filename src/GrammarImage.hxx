@@ -0,0 +1,200 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef GRAMMAR_IMAGE_H_INCLUDED
+#define GRAMMAR_IMAGE_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "Symbol.hxx"
+#include "GrammarAnalysis.hxx"
+#include "ParseTable.hxx"
+#include "Lexer.hxx"
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <stdint.h>
+
+class CFG;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* grammar image class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* everything the parsers need -- symbols, productions, nullable, FIRST, FOLLOW,
+ * the packed parse table, the lexer, if any, and the productions as they were
+ * written, if the grammar was rewritten -- laid out in one flat,
+ * 8-byte aligned block of fixed-width integers. sections are found through
+ * offsets from the start of the block, so the very same bytes work in memory,
+ * on disk, and mmap()ed at any address: loading a compiled grammar only checks
+ * its header. images are immutable and copies share their bytes. */
+class GrammarImage {
+private:
+    /* owns the bytes: a heap block or a mapping */
+    class Storage;
+    std::shared_ptr<const Storage> storage;
+    /* start of the image, NULL if empty */
+    const char *image;
+    size_t nbytes;
+    /* counts */
+    uint32_t nsymbols;
+    uint32_t nprods;
+    uint32_t nwords;
+    bool isStrong;
+    /* sections */
+    const uint32_t *nameOffsets;
+    const char *names;
+    const uint8_t *kinds;
+    const uint32_t *termIndex;
+    const uint32_t *nonTermIndex;
+    const SymbolID *lhss;
+    const uint32_t *rhsOffsets;
+    const SymbolID *rhss;
+    const SymbolID *reversedRhss;
+    const uint64_t *nullBits;
+    const uint64_t *firstBits;
+    const uint64_t *followBits;
+    const SymbolID *byteTerms;
+    const uint32_t *base;
+    const PackedSlot *slots;
+    /* as in CFG::originals() and CFG::origin(), but empty if the grammar
+     * wasn't rewritten */
+    uint32_t norigs;
+    const uint32_t *origins;
+    const SymbolID *origLhss;
+    const uint32_t *origRhsOffsets;
+    const SymbolID *origRhss;
+    /* over the lexer sections */
+    Lexer lex;
+    /* checks the header of a size byte image and points everything into it.
+     * what is a name for error messages. */
+    void attach(const std::shared_ptr<const Storage> &s,
+                size_t size,
+                const std::string &what);
+
+public:
+    /* what every image starts with */
+    static const char MAGIC[8];
+    /* bumped whenever the layout changes */
+    static const uint32_t FORMAT_VERSION;
+
+    GrammarImage(void);
+
+    ~GrammarImage(void) { ; }
+
+    /* lays out a crunched cfg and its packed parse table */
+    void build(const CFG &cfg, const PackedParseTable &table, bool strong);
+
+    void save(const std::string &path) const;
+
+    void load(const std::string &path);
+
+    /* does the file at path start like an image? */
+    static bool sniff(const std::string &path);
+
+    bool empty(void) const { return NULL == this->image; }
+
+    size_t bytes(void) const { return this->nbytes; }
+
+    /* whether or not the table is conflict-free */
+    bool strong(void) const { return this->isStrong; }
+
+    size_t symbols(void) const { return this->nsymbols; }
+
+    std::string name(SymbolID id) const;
+
+    bool terminal(SymbolID id) const { return 0 != this->kinds[id]; }
+
+    uint32_t terminalIndex(SymbolID id) const {
+        return id < this->nsymbols ? this->termIndex[id] :
+                                     GrammarAnalysis::NONE;
+    }
+
+    uint32_t nonTerminalIndex(SymbolID id) const {
+        return id < this->nsymbols ? this->nonTermIndex[id] :
+                                     GrammarAnalysis::NONE;
+    }
+
+    size_t productions(void) const { return this->nprods; }
+
+    SymbolID lhs(size_t p) const { return this->lhss[p]; }
+
+    const SymbolID *rhsBegin(size_t p) const {
+        return this->rhss + this->rhsOffsets[p];
+    }
+
+    const SymbolID *rhsEnd(size_t p) const {
+        return this->rhss + this->rhsOffsets[p + 1];
+    }
+
+    size_t rhsLength(size_t p) const {
+        return this->rhsOffsets[p + 1] - this->rhsOffsets[p];
+    }
+
+    /* p's right-hand side back to front, rhsLength(p) long */
+    const SymbolID *rhsReversed(size_t p) const {
+        return this->reversedRhss + this->rhsOffsets[p];
+    }
+
+    /* production p the way CFGProductions::str() prints it */
+    std::string str(size_t p) const;
+
+    /* index of the production as written that p was rewritten from, as in
+     * CFG::origin() */
+    uint32_t origin(size_t p) const {
+        return 0 == this->norigs ? static_cast<uint32_t>(p) : this->origins[p];
+    }
+
+    /* what p was rewritten from, the way verbose output lists it: "from" and
+     * the production as written, or "new" for productions that none of them
+     * accounts for. empty if p reads just as it was written. */
+    std::string originStr(size_t p) const;
+
+    bool nullable(SymbolID id) const {
+        uint32_t nt = this->nonTerminalIndex(id);
+        return GrammarAnalysis::NONE != nt &&
+               0 != (this->nullBits[nt >> 6] & (uint64_t(1) << (nt & 63)));
+    }
+
+    /* is terminal t in FIRST(id)? */
+    bool inFirst(SymbolID id, SymbolID t) const;
+
+    /* is terminal t in FOLLOW(id)? */
+    bool inFollow(SymbolID id, SymbolID t) const;
+
+    /* the terminals a parse can go on with when id is on top of the stack:
+     * id itself if it is a terminal, otherwise FIRST(id), and FOLLOW(id) as
+     * well if id is nullable. in SymbolID order, END last if it is one. */
+    std::vector<SymbolID> expects(SymbolID id) const;
+
+    /* production index in table cell (r, c) or ParseTable::ERROR */
+    uint32_t predict(uint32_t r, uint32_t c) const {
+        return packedAt(this->base, this->slots, r, c);
+    }
+
+    /* the terminal every input byte spells, see SymbolTable::byteTerminals */
+    const SymbolID *byteTerminals(void) const { return this->byteTerms; }
+
+    /* what splits input into terminals when the grammar has token rules.
+     * empty when it has none. */
+    const Lexer &lexer(void) const { return this->lex; }
+};
+
+#endif
@@ -19,10 +19,14 @@
 #include "Base.hxx"
 #include "Constants.hxx"
 #include "DialectException.hxx"
+#include "StrongDriver.hxx"
+#include "PushParser.hxx"
 
 #include <iostream>
+#include <sstream>
 #include <string>
-#include <stack>
+#include <algorithm>
+#include <unordered_map>
 
 using namespace std;
 
@@ -30,110 +34,293 @@ using namespace std;
 
 /* ////////////////////////////////////////////////////////////////////////// */
 static bool
-aInFiOfA(CFGProduction &alpha, const Symbol &a)
+aInFiOfA(const GrammarImage &image, size_t alpha, SymbolID a)
 {
-    /* first of alpha set */
-    set<Symbol> foa;
-    auto rhs = alpha.rhs();
-    auto rhss = rhs.begin();
-
     /* now figure out FIRST(alpha) */
-    while (rhs.end() != rhss) {
-        foa.insert(rhss->firsts().begin(), rhss->firsts().end());
-        if (!rhss->nullable()) break;
-        else ++rhss;
+    for (auto s = image.rhsBegin(alpha); s != image.rhsEnd(alpha); ++s) {
+        if (image.inFirst(*s, a)) return true;
+        if (!image.nullable(*s)) break;
     }
-    return (foa.end() != foa.find(a));
+    return false;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 static bool
-aInFoOfN(CFGProduction &N, const Symbol &a)
+rhsNullable(const GrammarImage &image, size_t alpha)
 {
-    return (N.lhs().follows().end() != N.lhs().follows().find(a));
+    for (auto s = image.rhsBegin(alpha); s != image.rhsEnd(alpha); ++s) {
+        if (!image.nullable(*s)) return false;
+    }
+    return true;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-/* XXX move to CFGProduction and rm similar routine in CFG */
-static bool
-alphaNullable(CFGProduction &alpha)
+static void
+emitTableEntry(const CFG &cfg,
+               SymbolID nt,
+               SymbolID t,
+               size_t p)
 {
-    for (const Symbol &s : alpha.rhs()) {
-        if (!s.nullable() && !s.epsilon()) return false;
-    }
-    return true;
+    const SymbolTable &symbols = cfg.symbols();
+    dout << "[" << symbols.name(nt) << "]" << "[" << symbols.name(t) << "] = "
+         << cfg.prods().str(p, symbols) << endl;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static void
-emitTableEntry(const Symbol &nt,
-               const Symbol &t,
-               const CFGProduction &p)
+static inline unsigned
+lowestBit(uint64_t bits)
 {
-    dout << "[" << nt << "]" << "[" << t << "] = " << p << endl;
+#if defined(__GNUC__)
+    return __builtin_ctzll(bits);
+#else
+    unsigned res = 0;
+    while (0 == (bits & 1)) { bits >>= 1; ++res; }
+    return res;
+#endif
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static bool
-tCellOccupied(CFGProduction &p)
+/* a cell that is already taken is a conflict, which the later production
+ * wins. */
+void
+StrongLL1Parser::fillCells(size_t p, vector<uint64_t> &predict, bool verbose)
 {
-    return Symbol::DEAD != p.lhs().sym();
+    const GrammarAnalysis &ga = this->_cfg.analysis();
+    SymbolID nont = this->_cfg.prods().lhs(p);
+    uint32_t r = ga.nonTerminalIndex(nont);
+    auto &pt = this->_table;
+
+    ga.predict(this->_cfg.prods(), p, predict);
+    for (size_t w = 0; w < predict.size(); ++w) {
+        for (uint64_t bits = predict[w]; 0 != bits; bits &= bits - 1) {
+            size_t c = w * 64 + lowestBit(bits);
+            uint32_t had = pt.at(r, c);
+            if (ParseTable::ERROR != had) {
+                ParseConflict pc = {nont, pt.colSymbol(c), had,
+                                    static_cast<uint32_t>(p)};
+                this->_conflicts[nont].push_back(pc);
+                if (verbose) dout << "*** CONFLICT ***" << endl;
+            }
+            pt.set(r, c, p);
+            if (verbose) emitTableEntry(this->_cfg, nont, pt.colSymbol(c), p);
+        }
+    }
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
+/* one pass over the productions. the work is in the size of their PREDICT
+ * sets. */
 void
 StrongLL1Parser::initTable(void)
 {
     bool verbose = this->_verbose;
-    auto nonTerminals = this->_cfg.getNonTerminals();
-    auto terminals = this->_cfg.getTerminals();
-    auto &pt = this->_table;
-    bool conflict = false;
+    const GrammarAnalysis &ga = this->_cfg.analysis();
+    const CFGProductions &prods = this->_cfg.prods();
+    vector<uint64_t> predict;
 
+    this->_table.reset(ga.nonTerminals(), ga.terminals());
+    this->_layout = ga.layout();
+    this->_imageCurrent = false;
+    this->_conflicts.clear();
     if (verbose) dout << "building LL(1) parse table ***" << endl;
-    for (CFGProduction &p : this->_cfg.prods()) {
-        for (const Symbol &nont : nonTerminals) {
-            if (nont == p.lhs()) {
-                for (const Symbol &t : terminals) {
-                    if (aInFiOfA(p, t)) {
-                        if (tCellOccupied(pt[nont][t])) {
-                            conflict = true;
-                            if (this->_verbose) {
-                                dout << "*** CONFLICT ***" << endl;
-                            }
-                        }
-                        pt[nont][t] = p;
-                        if (verbose) emitTableEntry(nont, t, p);
-                    }
-                    else if (alphaNullable(p) && aInFoOfN(p, t)) {
-                        if (tCellOccupied(pt[nont][t])) {
-                            conflict = true;
-                            if (verbose) dout << "*** CONFLICT ***" << endl;
-                        }
-                        pt[nont][t] = p;
-                        if (this->_verbose) emitTableEntry(nont, t, p);
-                    }
-                }
-            }
-        }
+    for (size_t p = 0; p < prods.size(); ++p) {
+        this->fillCells(p, predict, verbose);
     }
     if (verbose) {
         dout << "done building LL(1) parse table :: grammar is"
-             << (conflict ? " not " : " ") << "strong LL(1) ***"
+             << (this->_conflicts.empty() ? " " : " not ")
+             << "strong LL(1) ***" << endl;
+        dout << endl;
+    }
+    this->_built = true;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+StrongLL1Parser::buildImage(void)
+{
+    PackedParseTable packed;
+
+    packed.pack(this->_table);
+    this->_image.build(this->_cfg, packed, this->_conflicts.empty());
+    this->_imageCurrent = true;
+    /* made from the old image */
+    this->_scratch.predictions.clear();
+    if (this->_verbose) {
+        /* slots are four times the size of narrow dense cells, so small
+         * tables come out bigger */
+        bool smaller = packed.bytes() <= this->_table.bytes();
+        ostringstream ratio;
+        if (smaller) ratio << " (" << packed.ratio() << ":1)";
+        dout << "packed LL(1) parse table: " << packed.cells()
+             << " cells in " << packed.size() << " slots, "
+             << this->_table.bytes() << " B " << (smaller ? "down" : "up")
+             << " to " << packed.bytes() << " B" << ratio.str() << " ***"
              << endl;
+        dout << "grammar image: " << this->_image.bytes() << " B ***" << endl;
         dout << endl;
     }
-    if (conflict) {
-        throw DialectException(DIALECT_WHERE, "", false);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+const GrammarImage &
+StrongLL1Parser::compile(void)
+{
+    if (!this->_built) this->initTable();
+    if (!this->_imageCurrent) this->buildImage();
+    return this->_image;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+vector<ParseConflict>
+StrongLL1Parser::conflicts(void) const
+{
+    vector<ParseConflict> res;
+
+    for (auto &row : this->_conflicts) {
+        res.insert(res.end(), row.second.begin(), row.second.end());
+    }
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the filled cells of row r as (terminal, production) pairs */
+static void
+rowCells(const ParseTable &pt,
+         size_t r,
+         vector< pair<SymbolID, uint32_t> > &out)
+{
+    out.clear();
+    for (size_t c = 0; c < pt.cols(); ++c) {
+        uint32_t p = pt.at(r, c);
+        if (ParseTable::ERROR == p) continue;
+        out.push_back(make_pair(pt.colSymbol(c), p));
+    }
+    sort(out.begin(), out.end());
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the non-terminals whose rows differ between two tables of any layout */
+static vector<SymbolID>
+changedRows(const ParseTable &from, const ParseTable &to)
+{
+    unordered_map<SymbolID, size_t> fromRows;
+    vector< pair<SymbolID, uint32_t> > a, b;
+    vector<SymbolID> res;
+
+    for (size_t r = 0; r < from.rows(); ++r) fromRows[from.rowSymbol(r)] = r;
+    for (size_t r = 0; r < to.rows(); ++r) {
+        auto f = fromRows.find(to.rowSymbol(r));
+        rowCells(to, r, b);
+        if (fromRows.end() == f) a.clear();
+        else {
+            rowCells(from, f->second, a);
+            fromRows.erase(f);
+        }
+        if (a != b) res.push_back(to.rowSymbol(r));
+    }
+    for (auto &f : fromRows) {
+        rowCells(from, f.second, a);
+        if (!a.empty()) res.push_back(f.first);
+    }
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the same cells initTable() fills, but only for the given rows */
+vector<SymbolID>
+StrongLL1Parser::refillRows(const vector<SymbolID> &rows)
+{
+    const GrammarAnalysis &ga = this->_cfg.analysis();
+    const vector<SymbolID> &terminals = ga.terminals();
+    auto &pt = this->_table;
+    vector<uint32_t> before, after;
+    vector<uint64_t> predict;
+    vector<SymbolID> changed;
+
+    /* the image also has the productions, their sets, and whether or not
+     * there are conflicts, so any edit makes it stale. so is a row that
+     * gained or lost a conflict without any of its cells changing. */
+    this->_imageCurrent = false;
+    /* everything was renumbered, so start over */
+    if (ga.layout() != this->_layout) {
+        ParseTable old(pt);
+        auto oldConflicts = this->_conflicts;
+        this->initTable();
+        changed = changedRows(old, pt);
+        for (SymbolID nont : ga.nonTerminals()) {
+            bool had = oldConflicts.end() != oldConflicts.find(nont);
+            bool has = this->_conflicts.end() != this->_conflicts.find(nont);
+            if (had == has) continue;
+            if (changed.end() == find(changed.begin(), changed.end(), nont)) {
+                changed.push_back(nont);
+            }
+        }
+        return changed;
+    }
+    /* new symbols only ever add rows and columns */
+    if (pt.rows() != ga.nonTerminals().size() ||
+        pt.cols() != terminals.size()) {
+        pt.grow(ga.nonTerminals(), terminals);
+    }
+    for (SymbolID nont : rows) {
+        uint32_t r = ga.nonTerminalIndex(nont);
+        bool hadConflict = 0 != this->_conflicts.erase(nont);
+        pt.row(r, before);
+        pt.clearRow(r);
+        vector<uint32_t> prods(this->_cfg.prodIndex().byLHS(nont));
+        /* later productions win conflicts, just like in initTable() */
+        sort(prods.begin(), prods.end());
+        for (size_t p : prods) this->fillCells(p, predict, false);
+        bool conflict = this->_conflicts.end() != this->_conflicts.find(nont);
+        pt.row(r, after);
+        if (before == after && hadConflict == conflict) continue;
+        changed.push_back(nont);
+        if (this->_verbose) {
+            dout << "rebuilt LL(1) parse table row "
+                 << this->_cfg.symbols().name(nont)
+                 << (conflict ? " *** CONFLICT ***" : "") << endl;
+            for (size_t c = 0; c < terminals.size(); ++c) {
+                if (ParseTable::ERROR == after[c]) continue;
+                emitTableEntry(this->_cfg, nont, terminals[c], after[c]);
+            }
+        }
     }
+    return changed;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+vector<SymbolID>
+StrongLL1Parser::addProduction(const CFGProduction &p)
+{
+    if (this->compiled()) {
+        string estr = "compiled grammars are read-only";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    if (!this->_built) this->initTable();
+    return this->refillRows(this->_cfg.addProduction(p));
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+vector<SymbolID>
+StrongLL1Parser::removeProduction(size_t p)
+{
+    if (this->compiled()) {
+        string estr = "compiled grammars are read-only";
+        throw DialectException(DIALECT_WHERE, estr);
+    }
+    if (!this->_built) this->initTable();
+    return this->refillRows(this->_cfg.removeProduction(p));
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-LL1Parser::parse(const vector<Symbol> &input)
+LL1Parser::parse(SymbolView input)
 {
     try {
-        StrongLL1Parser sll1(this->_cfg);
+        StrongLL1Parser sll1 = this->_image.empty() ?
+                               StrongLL1Parser(this->_cfg) :
+                               StrongLL1Parser(this->_image);
         sll1.verbose(this->_verbose);
         sll1.parse(input);
     }
@@ -145,15 +332,20 @@ LL1Parser::parse(const vector<Symbol> &input)
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-StrongLL1Parser::parse(const vector<Symbol> &input)
+StrongLL1Parser::parse(SymbolView input)
 {
+    /* quiet means a verdict and nothing else */
+    if (!this->_verbose) {
+        if (!this->recognize(input)) traceReject();
+        cout << "*** success: input recognized by grammar ***" << endl;
+        return;
+    }
     try {
-        this->initTable();
         try {
             /* try strong if grammar is strong-ll(1) */
-            this->parseImpl(input, true);
+            this->parse(input, true);
             /* now try experimental dynamic parser */
-            this->parseImpl(input , false);
+            this->parse(input , false);
         }
         catch (DialectException &e) {
             throw e;
@@ -161,192 +353,277 @@ StrongLL1Parser::parse(const vector<Symbol> &input)
     }
     catch (DialectException &e) {
         /* not strong ll(1), so try experimental dynamic parser */
-        this->parseImpl(input , false);
+        this->parse(input , false);
     }
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static void
-emitParseState(const Symbol &in, const Symbol &tos, const CFGProduction &p)
+/* the dynamic parser's trace shows only right-hand sides, and what they
+ * were rewritten from */
+class DynamicTraceListener : public TraceParseListener<GrammarImage> {
+public:
+    DynamicTraceListener(const GrammarImage &image) :
+        TraceParseListener<GrammarImage>(image, "dynamic parse") { ; }
+
+    void onPredict(SymbolID nonTerminal, SymbolID in, size_t p) {
+        const GrammarImage &image = this->g;
+        string rhs;
+
+        if (image.rhsBegin(p) == image.rhsEnd(p)) {
+            rhs = SymbolTable::EPSILON_NAME;
+        }
+        for (auto s = image.rhsBegin(p); s != image.rhsEnd(p); ++s) {
+            rhs += image.name(*s);
+        }
+        string from = image.originStr(p);
+        if (!from.empty()) rhs += " (" + from + ")";
+        cout << "..." << traceInput(image, in)
+             << " top: " << image.name(nonTerminal) << " action: " << rhs
+             << endl;
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+StrongLL1Parser::strongParse(SymbolView input)
 {
-    cout << "..." << (Symbol::DEAD == in ? "" : " in: " + in.sym())
-         << " top: " << tos << " action: " << p << endl;
+    driveStrong(this->_image, input);
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static void
-emitParseState(const Symbol &in, const Symbol &tos, const stack<Symbol> &p)
+const uint32_t PredictionCache::UNKNOWN = UINT32_MAX - 1;
+const uint32_t PredictionCache::CONFLICT = UINT32_MAX - 2;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the one production of nont that input predicts: input is in its FIRST set
+ * or it is nullable and input can follow nont. ERROR if there's no such
+ * production and CONFLICT if there's more than one, whichever way each of
+ * them is predicted. */
+static uint32_t
+choose(const GrammarImage &image, SymbolID nont, SymbolID input)
 {
-    auto savep = p;
-    vector<Symbol> q;
-    cout << "..." << (Symbol::DEAD == in ? "" : " in: " + in.sym())
-         << " top: " << tos << " action: ";
-    while (!savep.empty()) {
-        q.push_back(savep.top());
-        savep.pop();
-    }
-    for (auto i = q.rbegin(); i != q.rend(); ++i) {
-        cout << *i;
-    }
-    cout << endl;
+    uint32_t chosen = ParseTable::ERROR;
+    size_t nchosen = 0;
+    bool follows = image.inFollow(nont, input);
+
+    for (size_t p = 0; p < image.productions(); ++p) {
+        if (nont != image.lhs(p)) continue;
+        if (aInFiOfA(image, p, input) ||
+            (follows && rhsNullable(image, p))) {
+            if (0 == nchosen++) chosen = p;
+        }
+    }
+    if (1 < nchosen) return PredictionCache::CONFLICT;
+    return chosen;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-static void
-stopParse(void)
+/* choose(), remembered in predictions */
+static uint32_t
+lookup(const GrammarImage &image,
+       PredictionCache &predictions,
+       SymbolID nont,
+       SymbolID input)
 {
-    string estr = "*** failure: input not recognized by grammar ***";
-    throw DialectException(DIALECT_WHERE, estr, false);
+    uint32_t col = image.terminalIndex(input);
+
+    if (GrammarAnalysis::NONE == col) return ParseTable::ERROR;
+    uint32_t &cell = predictions.at(image.nonTerminalIndex(nont), col);
+    if (PredictionCache::UNKNOWN == cell) cell = choose(image, nont, input);
+    return cell;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-void
-StrongLL1Parser::strongParse(const vector<Symbol> &_input)
+/* lookup() that throws where the grammar isn't LL(1). input that no
+ * production takes is ERROR, as it is in a table. */
+static uint32_t
+predict(const GrammarImage &image,
+        PredictionCache &predictions,
+        SymbolID nont,
+        SymbolID input)
 {
-    ParseTable &pt = this->_table;
-    stack<Symbol> stk;
-    auto input = _input;
+    uint32_t res = lookup(image, predictions, nont, input);
+
+    if (PredictionCache::CONFLICT == res) {
+        string estr = "*** grammar is not LL(1) ***";
+        throw DialectException(DIALECT_WHERE, estr, false);
+    }
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the dynamic parser's predictions, for driveRecovering(). a grammar that
+ * isn't LL(1) can't be recovered in, so conflicts still throw. */
+class DynamicPredictor {
+private:
+    const GrammarImage &image;
+    PredictionCache &predictions;
 
-    cout << endl << "--- starting strong table-driven parse" << endl;
+public:
+    DynamicPredictor(const GrammarImage &g,
+                     PredictionCache &cache) : image(g),
+                                               predictions(cache) { ; }
 
-    stk.push(this->_cfg.startSymbol());
+    uint32_t operator()(SymbolID nonTerminal, SymbolID in) const {
+        return predict(this->image, this->predictions, nonTerminal, in);
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* like driveStrong(), but predict() throws when more than one production
+ * fits, which is a fault of the grammar and not of the input */
+template <typename Listener>
+static bool
+driveDynamic(const GrammarImage &image,
+             SymbolView input,
+             Listener &listener,
+             ParseScratch &scratch)
+{
+    SymbolStack &stk = scratch.stk;
+    size_t at = 0;
+
+    stk.clear();
+    listener.onBegin();
+    stk.push(SymbolTable::START);
 
     while (!stk.empty()) {
-        Symbol top = stk.top();
-        Symbol in;
-        if (!input.empty()) in = *input.begin();
-        else in = Symbol(Symbol::END);
-        CFGProduction cp = pt[top][in];
-        if (top.terminal()) {
+        SymbolID top = stk.top();
+        SymbolID in = at == input.size() ? SymbolTable::END : input[at];
+        if (image.terminal(top)) {
             stk.pop();
-            if (top.epsilon()) continue;
-            if (top != in) goto dump;
-            cout << "+++ match: " << top << endl;
-            if (!input.empty()) input.erase(input.begin());
+            if (top != in) goto stuck;
+            listener.onMatch(top, at);
+            if (at != input.size()) ++at;
         }
-        else if (Symbol::DEAD == cp.lhs().sym()) goto dump;
         else {
-            emitParseState(in, top, cp);
+            uint32_t p = predict(image, scratch.predictions, top, in);
+            if (ParseTable::ERROR == p) goto stuck;
+            listener.onPredict(top, in, p);
             stk.pop();
-            for (auto s = cp.rhs().rbegin(); s != cp.rhs().rend(); ++s) {
-                stk.push(*s);
-            }
+            stk.push(image.rhsReversed(p), image.rhsLength(p));
         }
     }
-    cout << "--- done with strong table-driven parse" << endl;
-    if (stk.size() == 0 && input.empty()) {
-        cout << "*** success: input recognized by grammar ***" << endl;
-    }
-    else {
-dump:
-        cout << "*** failure: input not recognized by grammar ***" << endl;
-        cout << "*** begin state dump ***" << endl;
-        cout << "input empty: " << (input.empty() ? "yes" : "no") << endl;
-        while (!input.empty()) {
-            cout << " -- " << *input.begin() << endl;
-            input.erase(input.begin());
-        }
-        cout << "stack empty: " << (stk.empty() ? "yes" : "no") << endl;
-        while (!stk.empty()) {
-            cout << " -- " << stk.top() << endl;
-            stk.pop();
-        }
-        cout << "*** end state dump ***" << endl;
-        stopParse();
+    listener.onFinish();
+    if (at == input.size()) {
+        listener.onAccept();
+        return true;
     }
+stuck:
+    listener.onError(input, at, stk);
+    return false;
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-/* XXX -- this shouldn't be a member of StrongLL1Parser */
-stack<Symbol>
-StrongLL1Parser::predict(const Symbol &nont, const Symbol &input)
+void
+StrongLL1Parser::dynamicParse(SymbolView input)
 {
-    CFGProductions prods;
-    stack<Symbol> res;
-    CFGProductions productions = this->_cfg.prods();
-
-    for (CFGProduction &p : productions) {
-        if (nont == p.clhs()) {
-            if (aInFiOfA(p, input)) {
-                prods.push_back(p);
-            }
-        }
+    DynamicTraceListener trace(this->_image);
+
+    if (!driveDynamic(this->_image, input, trace, this->_scratch)) {
+        traceReject();
     }
-    if (prods.size() == 0) {
-        string estr = "*** input not recognized by parser ***";
-        throw DialectException(DIALECT_WHERE, estr, false);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+StrongLL1Parser::recognize(SymbolView input)
+{
+    NullParseListener quiet;
+
+    if (this->compile().strong()) {
+        return driveStrong(this->_image, input, quiet, this->_scratch.stk);
     }
-    if (prods.size() != 1) {
-        string estr = "*** grammar is not LL(1) ***";
-        throw DialectException(DIALECT_WHERE, estr, false);
+    return driveDynamic(this->_image, input, quiet, this->_scratch);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* remembers where the parse got stuck */
+class StuckParseListener : public NullParseListener {
+public:
+    /* offset of the next input symbol */
+    size_t at;
+
+    StuckParseListener(void) : at(0) { ; }
+
+    void onMatch(SymbolID /* terminal */, size_t offset) {
+        this->at = offset + 1;
     }
-    CFGProduction p = *prods.begin();
-    for (auto s = p.rhs().begin(); s != p.rhs().end(); ++s) {
-        res.push(*s);
+
+    void onError(SymbolView, size_t offset, SymbolStack &) {
+        this->at = offset;
     }
-    return res;
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+StrongLL1Parser::recognize(SymbolView input, size_t &stuckAt)
+{
+    return recognize(this->compile(), input, this->_scratch, stuckAt);
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
-void
-StrongLL1Parser::dynamicParse(const vector<Symbol> &_input)
+bool
+StrongLL1Parser::recognize(const char *begin, const char *end, size_t &stuckAt)
 {
-    auto input = _input;
-    stack<Symbol> stk;
+    const GrammarImage &image = this->compile();
 
-    cout << endl << "--- starting dynamic parse" << endl;
+    if (!image.strong() || !image.lexer().empty()) {
+        string estr = "grammar is not strong LL(1) or lexes its input";
+        throw DialectException(DIALECT_WHERE, estr, false);
+    }
+    StrongPushParser<GrammarImage> parser(image);
+    bool ok = parser.feed(begin, end - begin) && parser.finish();
+    if (!ok) stuckAt = parser.offset();
+    return ok;
+}
 
-    stk.push(this->_cfg.startSymbol());
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+StrongLL1Parser::recognize(const GrammarImage &image,
+                           SymbolView input,
+                           ParseScratch &scratch,
+                           size_t &stuckAt)
+{
+    StuckParseListener stuck;
+    bool ok = false;
 
-    while (!stk.empty()) {
-        Symbol top = stk.top();
-        Symbol in;
-        if (!input.empty()) in = *input.begin();
-        else in = Symbol(Symbol::END);
-        if (top.terminal()) {
-            stk.pop();
-            if (top.epsilon()) continue;
-            if (top != in) goto dump;
-            cout << "+++ match: " << top << endl;
-            if (!input.empty()) input.erase(input.begin());
-        }
-        else {
-            stk.pop();
-            auto prediction = predict(top, in);
-            emitParseState(in, top, prediction);
-            while (!prediction.empty()) {
-                stk.push(prediction.top());
-                prediction.pop();
-            }
-        }
+    if (image.strong()) {
+        ok = driveStrong(image, input, stuck, scratch.stk);
     }
-    cout << "--- done with dynamic parse" << endl;
-    if (stk.size() == 0 && input.empty()) {
-        cout << "*** success: input recognized by grammar ***" << endl;
-    }
-    else {
-dump:
-        cout << "*** failure: input not recognized by grammar ***" << endl;
-        cout << "*** begin state dump ***" << endl;
-        cout << "input empty: " << (input.empty() ? "yes" : "no") << endl;
-        while (!input.empty()) {
-            cout << " -- " << *input.begin() << endl;
-            input.erase(input.begin());
-        }
-        cout << "stack empty: " << (stk.empty() ? "yes" : "no") << endl;
-        while (!stk.empty()) {
-            cout << " -- " << stk.top() << endl;
-            stk.pop();
-        }
-        cout << "*** end state dump ***" << endl;
-        stopParse();
+    /* throws, for every input alike, where the grammar isn't LL(1) */
+    else ok = driveDynamic(image, input, stuck, scratch);
+    if (!ok) stuckAt = stuck.at;
+    return ok;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+size_t
+StrongLL1Parser::validate(SymbolView input,
+                          size_t budget,
+                          vector<ParseError> &errors)
+{
+    const GrammarImage &image = this->compile();
+    NullParseListener quiet;
+
+    if (image.strong()) {
+        TablePredictor<GrammarImage> predict(image);
+        return driveRecovering(image, predict, input, quiet,
+                               this->_scratch.stk, budget, errors);
     }
+    DynamicPredictor predict(image, this->_scratch.predictions);
+    return driveRecovering(image, predict, input, quiet, this->_scratch.stk,
+                           budget, errors);
 }
 
 /* ////////////////////////////////////////////////////////////////////////// */
 void
-StrongLL1Parser::parseImpl(const vector<Symbol> &input , bool strong)
+StrongLL1Parser::parse(SymbolView input, bool strong)
 {
+    const GrammarImage &image = this->compile();
+
+    if (strong && !image.strong()) {
+        throw DialectException(DIALECT_WHERE, "", false);
+    }
     if (strong) this->strongParse(input);
     else this->dynamicParse(input);
 }
@@ -24,17 +24,22 @@
 
 #include "Base.hxx"
 #include "CFG.hxx"
+#include "DialectException.hxx"
+#include "ParseTable.hxx"
+#include "GrammarImage.hxx"
+#include "StrongDriver.hxx"
 
-#include <stack>
 #include <vector>
 #include <map>
-
-typedef std::map<Symbol, std::map<Symbol, CFGProduction>> ParseTable;
+#include <string>
 
 class LL1Parser {
 protected:
     bool _verbose;
     CFG _cfg;
+    /* what the parsers run from. empty until built from _cfg, unless the
+     * parser was handed a compiled grammar. */
+    GrammarImage _image;
 
 public:
     LL1Parser(void) { this->_verbose = false; }
@@ -44,34 +49,171 @@ public:
     LL1Parser(const CFG &cfg) : _verbose(false),
                                 _cfg(cfg) { ; }
 
-    virtual void parse(const std::vector<Symbol> &input);
+    /* runs from a compiled grammar alone */
+    LL1Parser(const GrammarImage &image) : _verbose(false),
+                                          _image(image) { ; }
+
+    virtual void parse(SymbolView input);
 
     void verbose(bool v = true) { this->_verbose = v; }
 };
 
+/* the dynamic parser's predictions, each made the first time it's needed and
+ * then kept. rows and columns are those of the parse table. only good for
+ * the image they were made from. */
+class PredictionCache {
+private:
+    std::vector< std::vector<uint32_t> > cells;
+
+public:
+    /* not predicted yet */
+    static const uint32_t UNKNOWN;
+    /* more than one production fits */
+    static const uint32_t CONFLICT;
+
+    PredictionCache(void) { ; }
+
+    ~PredictionCache(void) { ; }
+
+    /* cell (r, c), UNKNOWN until set. grows the cache to fit it. */
+    uint32_t &at(uint32_t r, uint32_t c) {
+        if (this->cells.size() <= r) this->cells.resize(r + 1);
+        std::vector<uint32_t> &row = this->cells[r];
+        if (row.size() <= c) row.resize(c + 1, UNKNOWN);
+        return row[c];
+    }
+
+    void clear(void) { this->cells.clear(); }
+};
+
+/* what a parse needs of its own. everything else comes from a GrammarImage,
+ * which nothing writes to once it's built, so any number of threads can
+ * parse from one image at once as long as each brings its own scratch. */
+struct ParseScratch {
+    /* the parse stack */
+    SymbolStack stk;
+    /* kept from parse to parse */
+    PredictionCache predictions;
+};
+
 /* every strong-LL(1) grammar is an LL(1) grammar and vise-versa */
 class StrongLL1Parser : public LL1Parser {
 private:
     ParseTable _table;
+    /* whether or not _image matches _table and the grammar */
+    bool _imageCurrent;
+    /* whether or not _table has been built */
+    bool _built;
+    /* analysis layout _table was built against */
+    size_t _layout;
+    /* when handed a compiled grammar, there is no cfg behind the image */
+    bool compiled(void) const {
+        return this->_cfg.prods().empty() && !this->_image.empty();
+    }
+    /* every conflict, by table row */
+    std::map< SymbolID, std::vector<ParseConflict> > _conflicts;
+    /* for the parses run from this parser */
+    ParseScratch _scratch;
 
     void initTable(void);
 
-    std::stack<Symbol> predict(const Symbol &nont, const Symbol &input);
+    /* packs the table and lays it out with the grammar in _image */
+    void buildImage(void);
+
+    /* fills production p's PREDICT cells into its table row */
+    void fillCells(size_t p, std::vector<uint64_t> &predict, bool verbose);
 
-    void parseImpl(const std::vector<Symbol> &input, bool strong);
+    /* rebuilds the given table rows. returns the ones that changed, cells
+     * or conflicts. */
+    std::vector<SymbolID> refillRows(const std::vector<SymbolID> &rows);
 
-    void strongParse(const std::vector<Symbol> &input);
+    void strongParse(SymbolView input);
 
-    void dynamicParse(const std::vector<Symbol> &input);
+    void dynamicParse(SymbolView input);
 
 public:
-    StrongLL1Parser(void) : LL1Parser() { ; }
+    StrongLL1Parser(void) : LL1Parser(),
+                            _imageCurrent(false),
+                            _built(false),
+                            _layout(0) { ; }
 
     ~StrongLL1Parser(void) { ; }
 
-    StrongLL1Parser(const CFG &cfg) : LL1Parser(cfg) { ; }
-
-    virtual void parse(const std::vector<Symbol> &input);
+    StrongLL1Parser(const CFG &cfg) : LL1Parser(cfg),
+                                      _imageCurrent(false),
+                                      _built(false),
+                                      _layout(0) { ; }
+
+    /* compiled grammars come with their table and can't be edited */
+    StrongLL1Parser(const GrammarImage &image) : LL1Parser(image),
+                                                 _imageCurrent(true),
+                                                 _built(true),
+                                                 _layout(0) { ; }
+
+    virtual void parse(SymbolView input);
+
+    /* runs only the strong or only the dynamic parser. throws if the input
+     * is not recognized or, for the strong one, if the grammar isn't strong
+     * LL(1). */
+    void parse(SymbolView input, bool strong);
+
+    /* runs the strong parser, telling listener about every step, and returns
+     * whether or not input is recognized. throws if the grammar isn't strong
+     * LL(1). */
+    template <typename Listener>
+    bool parse(SymbolView input, Listener &listener) {
+        if (!this->compile().strong()) {
+            std::string estr = "grammar is not strong LL(1)";
+            throw DialectException(DIALECT_WHERE, estr, false);
+        }
+        return driveStrong(this->_image, input, listener);
+    }
+
+    /* whether or not input is in the language, found with whichever parser
+     * fits the grammar and without tracing anything. throws if the parse
+     * needs a prediction the grammar has more than one of, since that is
+     * the grammar's fault and not the input's. */
+    bool recognize(SymbolView input);
+
+    /* same, and when input isn't in the language, stuckAt is the offset of
+     * the first input symbol the parse couldn't take */
+    bool recognize(SymbolView input, size_t &stuckAt);
+
+    /* same, straight from bytes read the way UserInputReader reads them, so
+     * no symbol is ever stored. stuckAt counts symbols, not bytes. throws if
+     * the grammar isn't strong LL(1) or lexes its input. */
+    bool recognize(const char *begin, const char *end, size_t &stuckAt);
+
+    /* same, from a built image and scratch only. safe to call from any
+     * number of threads sharing image. */
+    static bool recognize(const GrammarImage &image,
+                          SymbolView input,
+                          ParseScratch &scratch,
+                          size_t &stuckAt);
+
+    /* parses all of input, getting past syntax errors in panic mode, and
+     * adds them to errors. stops after budget errors, unless budget is 0.
+     * returns the offset the parse stopped at. */
+    size_t validate(SymbolView input,
+                    size_t budget,
+                    std::vector<ParseError> &errors);
+
+    const CFG &grammar(void) const { return this->_cfg; }
+
+    /* builds whatever the parsers need that isn't current yet */
+    const GrammarImage &compile(void);
+
+    /* all the conflicts the table has, if it has been built */
+    std::vector<ParseConflict> conflicts(void) const;
+
+    SymbolID intern(const std::string &name) { return this->_cfg.intern(name); }
+
+    /* edit the grammar and patch only the table rows that the edit touched.
+     * both return the non-terminals whose rows changed or that gained or
+     * lost a conflict. */
+    std::vector<SymbolID> addProduction(const CFGProduction &p);
+
+    std::vector<SymbolID> removeProduction(size_t p);
 };
 
 #endif
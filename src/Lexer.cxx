@@ -0,0 +1,590 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Lexer.hxx"
+#include "Constants.hxx"
+#include "DialectException.hxx"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <bitset>
+#include <algorithm>
+
+#include <ctype.h>
+
+using namespace std;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* static utility functions */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+typedef bitset<256> ByteSet;
+
+static const uint32_t NO_STATE = UINT32_MAX;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a thompson nfa. every state moves on at most one set of bytes. */
+class NFA {
+public:
+    vector<ByteSet> on;
+    vector<uint32_t> to;
+    vector< vector<uint32_t> > eps;
+    /* the rule each state accepts, NO_STATE for none */
+    vector<uint32_t> rule;
+
+    size_t size(void) const { return this->on.size(); }
+
+    uint32_t add(void) {
+        this->on.push_back(ByteSet());
+        this->to.push_back(NO_STATE);
+        this->eps.push_back(vector<uint32_t>());
+        this->rule.push_back(NO_STATE);
+        return static_cast<uint32_t>(this->on.size() - 1);
+    }
+
+    /* sorts states and adds everything they reach on epsilon alone */
+    void closure(vector<uint32_t> &states, vector<bool> &in) const {
+        vector<uint32_t> todo(states);
+        in.assign(this->size(), false);
+        for (uint32_t s : states) in[s] = true;
+        while (!todo.empty()) {
+            uint32_t s = todo.back();
+            todo.pop_back();
+            for (uint32_t t : this->eps[s]) {
+                if (in[t]) continue;
+                in[t] = true;
+                states.push_back(t);
+                todo.push_back(t);
+            }
+        }
+        sort(states.begin(), states.end());
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a piece of the nfa with one way in and one way out */
+struct Fragment {
+    uint32_t start;
+    uint32_t end;
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* thrown at whatever is wrong with a pattern */
+struct PatternError {
+    string why;
+
+    PatternError(const string &w) : why(w) { ; }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* turns one pattern into an nfa fragment by recursive descent */
+class PatternCompiler {
+private:
+    NFA &nfa;
+    const string &pattern;
+    /* what is being compiled: [at, end) */
+    size_t at;
+    size_t end;
+
+    bool more(void) const { return this->at < this->end; }
+
+    char peek(void) const { return this->pattern[this->at]; }
+
+    Fragment bytes(const ByteSet &set) {
+        Fragment f = {this->nfa.add(), this->nfa.add()};
+        this->nfa.on[f.start] = set;
+        this->nfa.to[f.start] = f.end;
+        return f;
+    }
+
+    static int hexDigit(char c) {
+        if ('0' <= c && c <= '9') return c - '0';
+        if ('a' <= c && c <= 'f') return c - 'a' + 10;
+        if ('A' <= c && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    /* the bytes the escape after a backslash stands for */
+    ByteSet escape(void);
+
+    ByteSet byteClass(void);
+
+    Fragment alternation(void);
+
+    Fragment sequence(void);
+
+    Fragment repetition(void);
+
+    Fragment atom(void);
+
+    Fragment literal(void);
+
+public:
+    PatternCompiler(NFA &n, const string &p) : nfa(n),
+                                               pattern(p),
+                                               at(0),
+                                               end(p.size()) { ; }
+
+    /* throws PatternError */
+    Fragment compile(void);
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+ByteSet
+PatternCompiler::escape(void)
+{
+    ByteSet set;
+
+    if (!this->more()) throw PatternError("pattern ends in a \\");
+    char c = this->pattern[this->at++];
+    switch (c) {
+        case 'n': set.set('\n'); break;
+        case 't': set.set('\t'); break;
+        case 'r': set.set('\r'); break;
+        case 'f': set.set('\f'); break;
+        case 'v': set.set('\v'); break;
+        case 'x': {
+            int hi = this->more() ? hexDigit(this->pattern[this->at]) : -1;
+            int lo = this->at + 1 < this->end ?
+                     hexDigit(this->pattern[this->at + 1]) : -1;
+            if (-1 == hi || -1 == lo) {
+                throw PatternError("\\x needs two hex digits");
+            }
+            this->at += 2;
+            set.set(hi * 16 + lo);
+            break;
+        }
+        case 'd':
+        case 'D':
+            for (int b = '0'; b <= '9'; ++b) set.set(b);
+            break;
+        case 'w':
+        case 'W':
+            for (int b = 0; b < 256; ++b) {
+                if (isalnum(b) || '_' == b) set.set(b);
+            }
+            break;
+        case 's':
+        case 'S':
+            for (const char *w = " \t\n\r\f\v"; '\0' != *w; ++w) set.set(*w);
+            break;
+        default:
+            set.set(uint8_t(c));
+            break;
+    }
+    if ('D' == c || 'W' == c || 'S' == c) set.flip();
+    return set;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* just past the [ */
+ByteSet
+PatternCompiler::byteClass(void)
+{
+    ByteSet set;
+    bool negate = this->more() && '^' == this->peek();
+
+    if (negate) ++this->at;
+    /* a ] right away is a ] */
+    bool first = true;
+    while (this->more() && (first || ']' != this->peek())) {
+        first = false;
+        ByteSet one;
+        char lo = this->pattern[this->at++];
+        if ('\\' == lo) {
+            one = this->escape();
+            if (1 != one.count()) {
+                set |= one;
+                continue;
+            }
+            for (int b = 0; b < 256; ++b) if (one[b]) lo = char(b);
+        }
+        if (this->at + 1 < this->end && '-' == this->peek() &&
+            ']' != this->pattern[this->at + 1]) {
+            ++this->at;
+            char hi = this->pattern[this->at++];
+            if ('\\' == hi) {
+                ByteSet h = this->escape();
+                if (1 != h.count()) throw PatternError("bad range in []");
+                for (int b = 0; b < 256; ++b) if (h[b]) hi = char(b);
+            }
+            if (uint8_t(hi) < uint8_t(lo)) {
+                throw PatternError("backwards range in []");
+            }
+            for (int b = uint8_t(lo); b <= uint8_t(hi); ++b) set.set(b);
+        }
+        else set.set(uint8_t(lo));
+    }
+    if (!this->more()) throw PatternError("[ without a ]");
+    /* the ] */
+    ++this->at;
+    if (negate) set.flip();
+    if (set.none()) throw PatternError("[] matches nothing");
+    return set;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+Fragment
+PatternCompiler::alternation(void)
+{
+    Fragment f = this->sequence();
+
+    while (this->more() && '|' == this->peek()) {
+        ++this->at;
+        Fragment g = this->sequence();
+        Fragment both = {this->nfa.add(), this->nfa.add()};
+        this->nfa.eps[both.start].push_back(f.start);
+        this->nfa.eps[both.start].push_back(g.start);
+        this->nfa.eps[f.end].push_back(both.end);
+        this->nfa.eps[g.end].push_back(both.end);
+        f = both;
+    }
+    return f;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+Fragment
+PatternCompiler::sequence(void)
+{
+    uint32_t s = this->nfa.add();
+    Fragment f = {s, s};
+
+    while (this->more() && '|' != this->peek() && ')' != this->peek()) {
+        Fragment g = this->repetition();
+        this->nfa.eps[f.end].push_back(g.start);
+        f.end = g.end;
+    }
+    return f;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+Fragment
+PatternCompiler::repetition(void)
+{
+    Fragment f = this->atom();
+
+    while (this->more()) {
+        char op = this->peek();
+        if ('*' != op && '+' != op && '?' != op) break;
+        ++this->at;
+        uint32_t e = this->nfa.add();
+        /* leaving through e, and for * and +, going around again */
+        this->nfa.eps[f.end].push_back(e);
+        if ('?' != op) this->nfa.eps[f.end].push_back(f.start);
+        if ('+' != op) {
+            uint32_t s = this->nfa.add();
+            this->nfa.eps[s].push_back(f.start);
+            this->nfa.eps[s].push_back(e);
+            f.start = s;
+        }
+        f.end = e;
+    }
+    return f;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+Fragment
+PatternCompiler::atom(void)
+{
+    char c = this->pattern[this->at++];
+    ByteSet set;
+
+    switch (c) {
+        case '(': {
+            Fragment f = this->alternation();
+            if (!this->more()) throw PatternError("( without a )");
+            ++this->at;
+            return f;
+        }
+        case '[':
+            return this->bytes(this->byteClass());
+        case '.':
+            set.set();
+            set.reset('\n');
+            return this->bytes(set);
+        case '\\':
+            return this->bytes(this->escape());
+        case '*':
+        case '+':
+        case '?':
+            throw PatternError(string(1, c) + " with nothing to repeat");
+        default:
+            set.set(uint8_t(c));
+            return this->bytes(set);
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* backslash escapes work as they do in regexes, and only escape one byte */
+Fragment
+PatternCompiler::literal(void)
+{
+    uint32_t s = this->nfa.add();
+    Fragment f = {s, s};
+
+    while (this->more()) {
+        ByteSet set;
+        char c = this->pattern[this->at++];
+        if ('\\' == c) {
+            set = this->escape();
+            if (1 != set.count()) {
+                throw PatternError("literals only escape single bytes");
+            }
+        }
+        else set.set(uint8_t(c));
+        Fragment g = this->bytes(set);
+        this->nfa.eps[f.end].push_back(g.start);
+        f.end = g.end;
+    }
+    return f;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+Fragment
+PatternCompiler::compile(void)
+{
+    size_t n = this->pattern.size();
+    char open = 0 == n ? '\0' : this->pattern[0];
+    Fragment f;
+
+    if (2 > n || ('"' != open && '/' != open) || open != this->pattern[n - 1]) {
+        throw PatternError("patterns are \"literals\" or /regexes/");
+    }
+    this->at = 1;
+    this->end = n - 1;
+    if ('"' == open) f = this->literal();
+    else {
+        f = this->alternation();
+        if (this->more()) throw PatternError(") without a (");
+    }
+    vector<uint32_t> from(1, f.start);
+    vector<bool> in;
+    this->nfa.closure(from, in);
+    if (binary_search(from.begin(), from.end(), f.end)) {
+        throw PatternError("pattern matches the empty string");
+    }
+    return f;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* TokenRule */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+TokenRule::valid(const string &pattern, string &why)
+{
+    NFA nfa;
+
+    try {
+        PatternCompiler(nfa, pattern).compile();
+    }
+    catch (PatternError &e) {
+        why = e.why;
+        return false;
+    }
+    return true;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* Lexer */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+const uint32_t Lexer::DEAD  = 0;
+const uint32_t Lexer::START = 1;
+const uint32_t Lexer::ACCEPTING = uint32_t(1) << 31;
+/* NONE is taken by states that accept nothing */
+const SymbolID Lexer::SKIP  = UINT32_MAX - 1;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+size_t
+Lexer::lex(const char *begin, const char *end, vector<SymbolID> &out) const
+{
+    const uint8_t *at = reinterpret_cast<const uint8_t *>(begin);
+    const uint8_t *stop = reinterpret_cast<const uint8_t *>(end);
+    const uint8_t *cls = this->classes;
+    const uint32_t *mv = this->moves;
+    const SymbolID *acc = this->accepts;
+    const uint32_t k = this->nclasses;
+
+    while (stop != at) {
+        const uint8_t *last = NULL;
+        uint32_t row = START * k, accepted = 0;
+        for (const uint8_t *b = at; stop != b;) {
+            uint32_t m = mv[row + cls[*b++]];
+            row = m & ~ACCEPTING;
+            if (DEAD == row) break;
+            if (0 != (m & ACCEPTING)) {
+                last = b;
+                accepted = row;
+            }
+        }
+        if (NULL == last) break;
+        SymbolID token = acc[accepted / k];
+        if (SKIP != token) out.push_back(token);
+        at = last;
+    }
+    return at - reinterpret_cast<const uint8_t *>(begin);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* LexerTables */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* one nfa for all of the rules, then subset construction over classes of
+ * bytes, then moore's partition refinement down to the minimal dfa */
+LexerTables::LexerTables(const vector<TokenRule> &rules,
+                         const SymbolTable &symbols) : nclasses(0)
+{
+    NFA nfa;
+    /* what each rule accepts, by rule */
+    vector<SymbolID> ruleAccepts;
+    uint32_t start = nfa.add();
+
+    if (rules.empty()) return;
+    for (const TokenRule &r : rules) {
+        Fragment f;
+        try {
+            f = PatternCompiler(nfa, r.pattern).compile();
+        }
+        catch (PatternError &e) {
+            string estr = "bad token pattern " + r.pattern + ": " + e.why;
+            throw DialectException(DIALECT_WHERE, estr);
+        }
+        nfa.eps[start].push_back(f.start);
+        nfa.rule[f.end] = ruleAccepts.size();
+        ruleAccepts.push_back(SymbolTable::NONE == r.terminal ? Lexer::SKIP :
+                                                                r.terminal);
+    }
+    SymbolID byteTerminals[256];
+    symbols.byteTerminals(byteTerminals);
+    for (unsigned b = 0; b < 256; ++b) {
+        if (SymbolTable::NONE == byteTerminals[b]) continue;
+        Fragment f = {nfa.add(), nfa.add()};
+        nfa.on[f.start].set(b);
+        nfa.to[f.start] = f.end;
+        nfa.eps[start].push_back(f.start);
+        nfa.rule[f.end] = ruleAccepts.size();
+        ruleAccepts.push_back(byteTerminals[b]);
+    }
+    /* bytes every edge treats the same share a class */
+    vector<uint8_t> reps;
+    map<vector<bool>, uint8_t> signatures;
+    this->classes.resize(256);
+    for (unsigned b = 0; b < 256; ++b) {
+        vector<bool> sig;
+        for (size_t s = 0; s < nfa.size(); ++s) {
+            if (NO_STATE != nfa.to[s]) sig.push_back(nfa.on[s][b]);
+        }
+        auto found = signatures.find(sig);
+        if (signatures.end() == found) {
+            found = signatures.insert(make_pair(sig, reps.size())).first;
+            reps.push_back(b);
+        }
+        this->classes[b] = found->second;
+    }
+    const uint32_t k = reps.size();
+    /* subset construction. the empty set is the dead state. */
+    vector< vector<uint32_t> > subsets(1);
+    map<vector<uint32_t>, uint32_t> ids;
+    vector<uint32_t> dmoves;
+    vector<bool> in;
+    ids[subsets[0]] = Lexer::DEAD;
+    subsets.push_back(vector<uint32_t>(1, start));
+    nfa.closure(subsets.back(), in);
+    ids[subsets.back()] = Lexer::START;
+    for (size_t d = 0; d < subsets.size(); ++d) {
+        vector<uint32_t> from = subsets[d];
+        for (uint32_t c = 0; c < k; ++c) {
+            vector<uint32_t> next;
+            for (uint32_t s : from) {
+                if (NO_STATE != nfa.to[s] && nfa.on[s][reps[c]]) {
+                    next.push_back(nfa.to[s]);
+                }
+            }
+            nfa.closure(next, in);
+            auto found = ids.find(next);
+            if (ids.end() == found) {
+                found = ids.insert(make_pair(next, subsets.size())).first;
+                subsets.push_back(next);
+            }
+            dmoves.push_back(found->second);
+        }
+    }
+    const size_t n = subsets.size();
+    /* the first rule wins */
+    vector<SymbolID> daccepts(n, SymbolTable::NONE);
+    for (size_t d = 0; d < n; ++d) {
+        uint32_t best = NO_STATE;
+        for (uint32_t s : subsets[d]) best = min(best, nfa.rule[s]);
+        if (NO_STATE != best) daccepts[d] = ruleAccepts[best];
+    }
+    /* split blocks apart until the states in each agree on where they go */
+    vector<uint32_t> block(n);
+    map<SymbolID, uint32_t> byAccept;
+    for (size_t d = 0; d < n; ++d) {
+        block[d] = byAccept.insert(make_pair(daccepts[d],
+                                             byAccept.size())).first->second;
+    }
+    size_t nblocks = byAccept.size();
+    for (;;) {
+        map<vector<uint32_t>, uint32_t> sigs;
+        vector<uint32_t> next(n);
+        for (size_t d = 0; d < n; ++d) {
+            vector<uint32_t> sig(1, block[d]);
+            for (uint32_t c = 0; c < k; ++c) {
+                sig.push_back(block[dmoves[d * k + c]]);
+            }
+            next[d] = sigs.insert(make_pair(sig, sigs.size())).first->second;
+        }
+        block.swap(next);
+        if (sigs.size() == nblocks) break;
+        nblocks = sigs.size();
+    }
+    /* blocks become states, keeping dead and start where Lexer expects */
+    vector<uint32_t> renumber(nblocks, NO_STATE), rep;
+    renumber[block[Lexer::DEAD]] = Lexer::DEAD;
+    renumber[block[Lexer::START]] = Lexer::START;
+    rep.push_back(Lexer::DEAD);
+    rep.push_back(Lexer::START);
+    for (size_t d = 0; d < n; ++d) {
+        if (NO_STATE != renumber[block[d]]) continue;
+        renumber[block[d]] = rep.size();
+        rep.push_back(d);
+    }
+    this->nclasses = k;
+    this->accepts.resize(rep.size());
+    this->moves.resize(rep.size() * k);
+    for (size_t s = 0; s < rep.size(); ++s) {
+        this->accepts[s] = daccepts[rep[s]];
+        for (uint32_t c = 0; c < k; ++c) {
+            uint32_t d = dmoves[rep[s] * k + c];
+            this->moves[s * k + c] = renumber[block[d]] * k |
+                (SymbolTable::NONE == daccepts[d] ? 0 : Lexer::ACCEPTING);
+        }
+    }
+}
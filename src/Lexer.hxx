@@ -0,0 +1,150 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LEXER_H_INCLUDED
+#define LEXER_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "Symbol.hxx"
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* token rule class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a terminal spelled by a pattern instead of by its name: a "literal" or a
+ * /regex/. regexes know | * + ? ( ) [classes] . and the escapes \n \t \r
+ * \f \v \xHH \d \w \s \D \W \S. input matched by a rule whose terminal is
+ * NONE is skipped. */
+struct TokenRule {
+    SymbolID terminal;
+    std::string pattern;
+
+    TokenRule(SymbolID t, const std::string &p) : terminal(t), pattern(p) { ; }
+
+    /* whether or not pattern compiles and matches something other than the
+     * empty string. if not, why says why. */
+    static bool valid(const std::string &pattern, std::string &why);
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* lexer class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a table-driven scanner over a minimized DFA. bytes are first mapped to
+ * classes of bytes no rule tells apart, so a move is one load from a row of
+ * nclasses moves. a move is the offset of the row of the state it goes to,
+ * with ACCEPTING set if that state accepts, so the loop never multiplies.
+ * state 0 is dead and state 1 is the start. a view: the tables belong to
+ * LexerTables or to a GrammarImage, and must outlive it. */
+class Lexer {
+private:
+    uint32_t nstates;
+    uint32_t nclasses;
+    /* [256] */
+    const uint8_t *classes;
+    /* [nstates * nclasses], see above */
+    const uint32_t *moves;
+    /* [nstates], the terminal each state accepts, NONE or SKIP */
+    const SymbolID *accepts;
+
+public:
+    static const uint32_t DEAD;
+    static const uint32_t START;
+    /* set in moves to accepting states */
+    static const uint32_t ACCEPTING;
+    /* what states that accept skipped input accept */
+    static const SymbolID SKIP;
+
+    Lexer(void) : nstates(0),
+                  nclasses(0),
+                  classes(NULL),
+                  moves(NULL),
+                  accepts(NULL) { ; }
+
+    Lexer(uint32_t states,
+          uint32_t nclass,
+          const uint8_t *byteClasses,
+          const uint32_t *stateMoves,
+          const SymbolID *stateAccepts) : nstates(states),
+                                          nclasses(nclass),
+                                          classes(byteClasses),
+                                          moves(stateMoves),
+                                          accepts(stateAccepts) { ; }
+
+    ~Lexer(void) { ; }
+
+    /* no rules, so input is read a byte at a time */
+    bool empty(void) const { return 0 == this->nstates; }
+
+    uint32_t states(void) const { return this->nstates; }
+
+    uint32_t classCount(void) const { return this->nclasses; }
+
+    const uint8_t *byteClasses(void) const { return this->classes; }
+
+    const uint32_t *stateMoves(void) const { return this->moves; }
+
+    const SymbolID *stateAccepts(void) const { return this->accepts; }
+
+    /* appends the terminals of [begin, end) to out, taking the longest match
+     * and, of rules matching as much, the first. returns the offset of the
+     * first byte no token starts at, or end - begin if there is none. */
+    size_t lex(const char *begin,
+               const char *end,
+               std::vector<SymbolID> &out) const;
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* lexer tables class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* owns the tables a Lexer runs from */
+class LexerTables {
+private:
+    uint32_t nclasses;
+    std::vector<uint8_t> classes;
+    std::vector<uint32_t> moves;
+    std::vector<SymbolID> accepts;
+
+public:
+    LexerTables(void) : nclasses(0) { ; }
+
+    /* compiles rules, in priority order, followed by a literal for every
+     * byte that spells a terminal of symbols. no rules, no tables. throws
+     * if a rule's pattern is not valid. */
+    LexerTables(const std::vector<TokenRule> &rules,
+                const SymbolTable &symbols);
+
+    ~LexerTables(void) { ; }
+
+    bool empty(void) const { return this->accepts.empty(); }
+
+    Lexer lexer(void) const {
+        if (this->empty()) return Lexer();
+        return Lexer(this->accepts.size(), this->nclasses,
+                     this->classes.data(), this->moves.data(),
+                     this->accepts.data());
+    }
+};
+
+#endif
@@ -0,0 +1,192 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ParseTable.hxx"
+
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+const uint32_t ParseTable::ERROR;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ParseTable::reset(const vector<SymbolID> &rows,
+                  const vector<SymbolID> &cols)
+{
+    this->rowSyms = rows;
+    this->colSyms = cols;
+    this->isWide = false;
+    this->wide.clear();
+    this->narrow.assign(rows.size() * cols.size(), 0);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename T>
+static void
+regrid(vector<T> &cells, size_t oldCols, size_t rows, size_t cols)
+{
+    if (oldCols == cols) {
+        cells.resize(rows * cols, 0);
+        return;
+    }
+    vector<T> res(rows * cols, 0);
+    for (size_t r = 0; r < cells.size() / max(oldCols, size_t(1)); ++r) {
+        copy(cells.begin() + r * oldCols, cells.begin() + (r + 1) * oldCols,
+             res.begin() + r * cols);
+    }
+    cells.swap(res);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ParseTable::grow(const vector<SymbolID> &rows,
+                 const vector<SymbolID> &cols)
+{
+    size_t oldCols = this->colSyms.size();
+
+    if (this->isWide) regrid(this->wide, oldCols, rows.size(), cols.size());
+    else regrid(this->narrow, oldCols, rows.size(), cols.size());
+    this->rowSyms = rows;
+    this->colSyms = cols;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ParseTable::widen(void)
+{
+    this->wide.assign(this->narrow.begin(), this->narrow.end());
+    vector<uint16_t>().swap(this->narrow);
+    this->isWide = true;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ParseTable::set(size_t r, size_t c, uint32_t p)
+{
+    size_t i = r * this->colSyms.size() + c;
+
+    if (!this->isWide && p + 1 > UINT16_MAX) this->widen();
+    if (this->isWide) this->wide[i] = p + 1;
+    else this->narrow[i] = static_cast<uint16_t>(p + 1);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ParseTable::clearRow(size_t r)
+{
+    size_t ncols = this->colSyms.size();
+
+    if (this->isWide) {
+        fill(this->wide.begin() + r * ncols,
+             this->wide.begin() + (r + 1) * ncols, 0);
+    }
+    else {
+        fill(this->narrow.begin() + r * ncols,
+             this->narrow.begin() + (r + 1) * ncols, 0);
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ParseTable::row(size_t r, vector<uint32_t> &out) const
+{
+    out.resize(this->colSyms.size());
+    for (size_t c = 0; c < out.size(); ++c) out[c] = this->at(r, c);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* PackedParseTable */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+const uint32_t PackedParseTable::NONE = UINT32_MAX;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* smallest free slot at or after i. taken slots point further along, and
+ * every lookup shortens the chains it walks. */
+static size_t
+findFree(vector<uint32_t> &next, size_t i)
+{
+    size_t root = i;
+
+    while (root < next.size() && next[root] != root) root = next[root];
+    while (i < next.size() && next[i] != i) {
+        size_t n = next[i];
+        next[i] = root;
+        i = n;
+    }
+    return root;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* first fit, fullest rows first: the sparse rows at the end then mostly drop
+ * into the gaps the full ones left behind. only displacements that put a
+ * row's first cell on a free slot are ever tried. */
+void
+PackedParseTable::pack(const ParseTable &table)
+{
+    size_t nrows = table.rows(), ncols = table.cols();
+    /* filled columns of every row, in compressed sparse row form */
+    vector<uint32_t> offsets(nrows + 1, 0), cols, order(nrows);
+    /* next[s] == s for free slots */
+    vector<uint32_t> next;
+
+    for (size_t r = 0; r < nrows; ++r) {
+        for (size_t c = 0; c < ncols; ++c) {
+            if (ParseTable::ERROR != table.at(r, c)) cols.push_back(c);
+        }
+        offsets[r + 1] = cols.size();
+        order[r] = r;
+    }
+    stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return offsets[a + 1] - offsets[a] > offsets[b + 1] - offsets[b];
+    });
+    this->ncells = cols.size();
+    this->denseBytes = table.bytes();
+    this->base.assign(nrows, 0);
+    for (uint32_t r : order) {
+        const uint32_t *cb = cols.data() + offsets[r];
+        const uint32_t *ce = cols.data() + offsets[r + 1];
+        if (cb == ce) continue;
+        size_t b = findFree(next, *cb) - *cb;
+        for (;;) {
+            const uint32_t *c = cb + 1;
+            for (; ce != c; ++c) {
+                size_t slot = b + *c;
+                if (slot < next.size() && slot != next[slot]) break;
+            }
+            if (ce == c) break;
+            b = findFree(next, b + *cb + 1) - *cb;
+        }
+        while (next.size() < b + ncols) next.push_back(next.size());
+        for (const uint32_t *c = cb; ce != c; ++c) next[b + *c] = b + *c + 1;
+        this->base[r] = b;
+    }
+    PackedSlot free = {NONE, 0};
+    /* the padding keeps at() from ever going out of bounds */
+    this->slots.assign(max(next.size(), ncols), free);
+    for (size_t r = 0; r < nrows; ++r) {
+        for (uint32_t i = offsets[r]; i < offsets[r + 1]; ++i) {
+            PackedSlot &s = this->slots[this->base[r] + cols[i]];
+            s.row = r;
+            s.prod = table.at(r, cols[i]);
+        }
+    }
+}
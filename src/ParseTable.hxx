@@ -0,0 +1,178 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PARSE_TABLE_H_INCLUDED
+#define PARSE_TABLE_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "Symbol.hxx"
+
+#include <vector>
+
+#include <stdint.h>
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* two productions that want the same cell */
+struct ParseConflict {
+    SymbolID nonTerminal;
+    SymbolID terminal;
+    /* the production that had the cell and the one that took it over */
+    uint32_t first;
+    uint32_t second;
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* parse table class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a dense (non-terminal, terminal) matrix of production indices, row major.
+ * rows and columns follow the GrammarAnalysis numbering the table was laid out
+ * with. a cell holds its production index plus one, so zeroed cells are error
+ * cells. cells stay 16 bits wide until some production index doesn't fit. */
+class ParseTable {
+private:
+    /* symbol id of every row */
+    std::vector<SymbolID> rowSyms;
+    /* symbol id of every column */
+    std::vector<SymbolID> colSyms;
+    /* cells while narrow */
+    std::vector<uint16_t> narrow;
+    /* cells once wide */
+    std::vector<uint32_t> wide;
+    /* which one of the above is in use */
+    bool isWide;
+    /* switches over to 32-bit cells */
+    void widen(void);
+
+public:
+    /* error cell. initialized here, as GrammarAnalysis::NONE is. */
+    static const uint32_t ERROR = UINT32_MAX;
+
+    ParseTable(void) : isWide(false) { ; }
+
+    ~ParseTable(void) { ; }
+
+    /* lays out an all-error table */
+    void reset(const std::vector<SymbolID> &rows,
+               const std::vector<SymbolID> &cols);
+
+    /* appends rows and columns, keeping every cell that is already there */
+    void grow(const std::vector<SymbolID> &rows,
+              const std::vector<SymbolID> &cols);
+
+    size_t rows(void) const { return this->rowSyms.size(); }
+
+    size_t cols(void) const { return this->colSyms.size(); }
+
+    SymbolID rowSymbol(size_t r) const { return this->rowSyms[r]; }
+
+    SymbolID colSymbol(size_t c) const { return this->colSyms[c]; }
+
+    /* production index in cell (r, c) or ERROR */
+    uint32_t at(size_t r, size_t c) const {
+        size_t i = r * this->colSyms.size() + c;
+        /* zero wraps around to ERROR */
+        return (this->isWide ? this->wide[i] : this->narrow[i]) - 1u;
+    }
+
+    void set(size_t r, size_t c, uint32_t p);
+
+    /* sets every cell of row r to ERROR */
+    void clearRow(size_t r);
+
+    /* copies row r into out as production indices */
+    void row(size_t r, std::vector<uint32_t> &out) const;
+
+    size_t bytes(void) const {
+        return this->narrow.size() * sizeof(uint16_t) +
+               this->wide.size() * sizeof(uint32_t);
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* packed parse table class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* one slot of a packed table's shared vector */
+struct PackedSlot {
+    /* owning row, PackedParseTable::NONE if free */
+    uint32_t row;
+    uint32_t prod;
+};
+
+/* production index in cell (r, c) of a packed table or ParseTable::ERROR */
+inline uint32_t
+packedAt(const uint32_t *base, const PackedSlot *slots, size_t r, size_t c)
+{
+    const PackedSlot &s = slots[base[r] + c];
+    return r == s.row ? s.prod : ParseTable::ERROR;
+}
+
+/* row displacement (comb vector) packing of a ParseTable. the filled cells of
+ * every row are slid along one shared vector until they only land on free
+ * slots, so cell (r, c) lives in slot base[r] + c. every slot remembers which
+ * row owns it, which is what makes error cells free. */
+class PackedParseTable {
+private:
+    /* displacement of every row */
+    std::vector<uint32_t> base;
+    /* the comb, padded so that any column of any row is in bounds */
+    std::vector<PackedSlot> slots;
+    /* number of filled cells */
+    size_t ncells;
+    /* size of the table this was packed from */
+    size_t denseBytes;
+
+public:
+    /* free slot */
+    static const uint32_t NONE;
+
+    PackedParseTable(void) : ncells(0), denseBytes(0) { ; }
+
+    ~PackedParseTable(void) { ; }
+
+    void pack(const ParseTable &table);
+
+    /* production index in cell (r, c) or ParseTable::ERROR */
+    uint32_t at(size_t r, size_t c) const {
+        return packedAt(this->base.data(), this->slots.data(), r, c);
+    }
+
+    const std::vector<uint32_t> &displacements(void) const {
+        return this->base;
+    }
+
+    const std::vector<PackedSlot> &comb(void) const { return this->slots; }
+
+    size_t cells(void) const { return this->ncells; }
+
+    size_t size(void) const { return this->slots.size(); }
+
+    size_t bytes(void) const {
+        return this->base.size() * sizeof(uint32_t) +
+               this->slots.size() * sizeof(PackedSlot);
+    }
+
+    /* dense bytes per packed byte */
+    double ratio(void) const {
+        return 0 == this->bytes() ? 1.0 : double(this->denseBytes) /
+                                          double(this->bytes());
+    }
+};
+
+#endif
@@ -0,0 +1,219 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef PARSE_TREE_H_INCLUDED
+#define PARSE_TREE_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "Symbol.hxx"
+#include "StrongDriver.hxx"
+
+#include <iostream>
+#include <stack>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* parse tree class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a node's children are next to each other in the tree's node array, one per
+ * symbol of the right-hand side it was expanded by, so a node is just that
+ * production and where its children are. what a node derives is the symbol
+ * in its place on its parent's right-hand side. */
+struct ParseNode {
+    /* production the node was expanded by. NONE for leaves and for
+     * non-terminals the parse never got to. */
+    uint32_t production;
+    /* index of the first child or, for terminals, the input offset matched.
+     * NONE for nodes the parse never got to. */
+    uint32_t first;
+};
+
+/* nodes live in one arena that only ever grows, so building a tree is
+ * bumping used, and clear() frees the whole tree at once while keeping the
+ * memory for the next one. node 0 is the root, S'. */
+class ParseTree {
+private:
+    /* the arena. only the first used nodes are the tree. */
+    std::vector<ParseNode> nodes;
+    size_t used;
+    /* makes room for n more nodes and returns the first of them */
+    ParseNode *bump(size_t n);
+
+    template <typename Grammar> friend class ParseTreeBuilder;
+
+public:
+    static const uint32_t NONE = UINT32_MAX;
+
+    ParseTree(void) : used(0) { ; }
+
+    ~ParseTree(void) { ; }
+
+    bool empty(void) const { return 0 == this->used; }
+
+    size_t size(void) const { return this->used; }
+
+    size_t bytes(void) const { return this->size() * sizeof(ParseNode); }
+
+    const ParseNode &root(void) const { return this->nodes[0]; }
+
+    const ParseNode &node(size_t n) const { return this->nodes[n]; }
+
+    /* the first of n's children. there are as many as there are symbols on
+     * the right-hand side of n.production, which n must have. */
+    const ParseNode *children(const ParseNode &n) const {
+        return this->nodes.data() + n.first;
+    }
+
+    void clear(void) { this->used = 0; }
+
+    /* one node per line, children indented under their parent. productions
+     * that were rewritten say what from. */
+    template <typename Grammar>
+    void emit(std::ostream &out, const Grammar &g) const;
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a parse listener that builds the derivation into a ParseTree. the drivers
+ * report in leftmost derivation order, so the next node to fill in is always
+ * the next child of the innermost node whose children aren't all filled in
+ * yet. those runs of children are kept on a stack, one entry per node and
+ * not per child, and every node is written exactly once: when it is
+ * predicted or matched or, if the parse never gets to it, when it fails. */
+template <typename Grammar>
+class ParseTreeBuilder : public NullParseListener {
+private:
+    /* children [next, end) of some node are still to be filled in */
+    struct Run {
+        uint32_t next;
+        uint32_t end;
+    };
+    const Grammar &g;
+    ParseTree &tree;
+    /* the top is runs[top - 1]. grown like the arena. */
+    std::vector<Run> runs;
+    size_t top;
+
+    /* the node reported on next */
+    uint32_t take(void) {
+        Run &run = this->runs[this->top - 1];
+        uint32_t n = run.next++;
+        if (run.next == run.end) --this->top;
+        return n;
+    }
+
+public:
+    ParseTreeBuilder(const Grammar &grammar,
+                     ParseTree &into) : g(grammar), tree(into), top(0) { ; }
+
+    void onBegin(void) {
+        Run root = {0, 1};
+        this->tree.clear();
+        this->tree.bump(1);
+        if (this->runs.empty()) this->runs.resize(64);
+        this->runs[0] = root;
+        this->top = 1;
+    }
+
+    void onPredict(SymbolID /* nonTerminal */, SymbolID /* in */, size_t p) {
+        uint32_t count = static_cast<uint32_t>(this->g.rhsLength(p));
+        uint32_t n = this->take();
+        uint32_t first = static_cast<uint32_t>(this->tree.used);
+        ParseNode expanded = {static_cast<uint32_t>(p), first};
+
+        this->tree.bump(count);
+        this->tree.nodes[n] = expanded;
+        if (0 == count) return;
+        if (this->top == this->runs.size()) {
+            this->runs.resize(2 * this->runs.size());
+        }
+        Run children = {first, first + count};
+        this->runs[this->top++] = children;
+    }
+
+    void onMatch(SymbolID /* terminal */, size_t offset) {
+        ParseNode leaf = {ParseTree::NONE, static_cast<uint32_t>(offset)};
+        this->tree.nodes[this->take()] = leaf;
+    }
+
+    void onError(SymbolView /* input */,
+                 size_t /* offset */,
+                 SymbolStack & /* stk */) {
+        ParseNode unreached = {ParseTree::NONE, ParseTree::NONE};
+        for (; 0 != this->top; --this->top) {
+            const Run &run = this->runs[this->top - 1];
+            for (uint32_t n = run.next; n != run.end; ++n) {
+                this->tree.nodes[n] = unreached;
+            }
+        }
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+inline ParseNode *
+ParseTree::bump(size_t n)
+{
+    if (this->used + n > this->nodes.size()) {
+        this->nodes.resize(2 * (this->used + n));
+    }
+    ParseNode *res = this->nodes.data() + this->used;
+    this->used += n;
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename Grammar>
+void
+ParseTree::emit(std::ostream &out, const Grammar &g) const
+{
+    /* node, what it derives, and depth. iterative, because trees get deep. */
+    struct Todo {
+        uint32_t node;
+        SymbolID symbol;
+        size_t depth;
+    };
+    std::stack<Todo> todo;
+
+    if (this->empty()) return;
+    Todo root = {0, SymbolTable::START, 0};
+    todo.push(root);
+    while (!todo.empty()) {
+        Todo t = todo.top();
+        const ParseNode &n = this->nodes[t.node];
+        todo.pop();
+        out << std::string(2 * t.depth, ' ');
+        if (NONE == n.production) {
+            out << g.name(t.symbol) << std::endl;
+            continue;
+        }
+        out << traceProduction(g, n.production) << std::endl;
+        const SymbolID *rhs = g.rhsBegin(n.production);
+        for (size_t c = g.rhsLength(n.production); c-- > 0;) {
+            Todo child = {n.first + static_cast<uint32_t>(c), rhs[c],
+                          t.depth + 1};
+            todo.push(child);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,188 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* times the parser dialect --emit-cpp generated for a grammar against the
+ * interpreted strong parser running the same grammar, compiled with --compile,
+ * and what building the parse tree adds to the interpreted one. built by make
+ * bench. */
+
+#include "Constants.hxx"
+#include "DialectException.hxx"
+#include "GrammarImage.hxx"
+#include "LL1Parser.hxx"
+#include "ParseTree.hxx"
+/* generated */
+#include "BenchGrammar.hxx"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+
+using namespace std;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a random sentence of about n bytes. past n, every non-terminal takes the
+ * production that derives its shortest string, which always terminates. */
+static string
+sentence(const GrammarImage &g, size_t n)
+{
+    const size_t INF = SIZE_MAX;
+    vector<size_t> shortest(g.symbols(), INF);
+    vector<uint32_t> shortestProd(g.symbols(), 0);
+    vector< vector<uint32_t> > byLHS(g.symbols());
+    string res;
+
+    for (size_t p = 0; p < g.productions(); ++p) byLHS[g.lhs(p)].push_back(p);
+    for (SymbolID id = 0; id < g.symbols(); ++id) {
+        if (g.terminal(id)) shortest[id] = SymbolTable::END == id ? 0 : 1;
+    }
+    /* only ever lowered, so every chosen production's right-hand side was
+     * settled before it */
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t p = 0; p < g.productions(); ++p) {
+            size_t len = 0;
+            for (auto s = g.rhsBegin(p); INF != len && s != g.rhsEnd(p); ++s) {
+                len = INF == shortest[*s] ? INF : len + shortest[*s];
+            }
+            if (len < shortest[g.lhs(p)]) {
+                shortest[g.lhs(p)] = len;
+                shortestProd[g.lhs(p)] = p;
+                changed = true;
+            }
+        }
+    }
+    /* non-terminals that only derive strings of bounded length */
+    vector<bool> bounded(g.symbols(), false);
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (SymbolID id = 0; id < g.symbols(); ++id) {
+            bool b = !bounded[id];
+            for (uint32_t p : byLHS[id]) {
+                for (auto s = g.rhsBegin(p); b && s != g.rhsEnd(p); ++s) {
+                    b = g.terminal(*s) || bounded[*s];
+                }
+            }
+            if (b) bounded[id] = changed = true;
+        }
+    }
+    vector<SymbolID> stk(1, SymbolTable::START);
+    /* shortest string the stack can still derive */
+    size_t pending = shortest[SymbolTable::START];
+    while (!stk.empty()) {
+        SymbolID top = stk.back();
+        stk.pop_back();
+        pending -= shortest[top];
+        if (g.terminal(top)) {
+            if (SymbolTable::END != top) res += g.name(top)[0];
+            continue;
+        }
+        uint32_t p = shortestProd[top];
+        if (res.size() + pending < n) {
+            /* short of n, keep going with something that can grow */
+            vector<uint32_t> growing;
+            for (uint32_t q : byLHS[top]) {
+                bool finite = true, grows = false;
+                for (auto s = g.rhsBegin(q); s != g.rhsEnd(q); ++s) {
+                    finite = finite && INF != shortest[*s];
+                    grows = grows || !bounded[*s];
+                }
+                if (finite && grows) growing.push_back(q);
+            }
+            if (!growing.empty()) p = growing[rand() % growing.size()];
+        }
+        for (auto s = g.rhsEnd(p); s != g.rhsBegin(p);) {
+            stk.push_back(*--s);
+            pending += shortest[*s];
+        }
+    }
+    return res;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename F>
+static double
+msPerRound(size_t rounds, F f)
+{
+    auto start = chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; ++r) f();
+    chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+    return ms.count() / rounds;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+int
+main(int argc, char **argv)
+{
+    if (argc < 2 || argc > 4) {
+        cerr << "usage: dialect-bench grammar.dlt [bytes] [rounds]" << endl;
+        return EXIT_FAILURE;
+    }
+    size_t n = argc > 2 ? strtoul(argv[2], NULL, 10) : 1 << 16;
+    size_t rounds = argc > 3 ? strtoul(argv[3], NULL, 10) : 20;
+    try {
+        GrammarImage image;
+        image.load(argv[1]);
+        if (BenchGrammar::symbols != image.symbols() ||
+            BenchGrammar::productions != image.productions()) {
+            cerr << argv[1] << " isn't the grammar BenchGrammar.hxx was "
+                 << "generated from" << endl;
+            return EXIT_FAILURE;
+        }
+        string text = sentence(image, n);
+        vector<SymbolID> input;
+        for (unsigned char c : text) {
+            input.push_back(image.byteTerminals()[c]);
+        }
+        if (!BenchGrammar::parse(text.data(), text.data() + text.size())) {
+            cerr << "generated parser rejected its input" << endl;
+            return EXIT_FAILURE;
+        }
+        StrongLL1Parser sll1(image);
+        NullParseListener quiet;
+        bool ok = true;
+        double interpreted = msPerRound(rounds, [&]() {
+            ok &= sll1.parse(input, quiet);
+        });
+        /* the tree's memory is reused from round to round */
+        ParseTree tree;
+        ParseTreeBuilder<GrammarImage> builder(image, tree);
+        double treed = msPerRound(rounds, [&]() {
+            ok &= sll1.parse(input, builder);
+        });
+        double generated = msPerRound(rounds, [&]() {
+            ok &= BenchGrammar::parse(text.data(), text.data() + text.size());
+        });
+        cout << "input: " << text.size() << " B, " << rounds << " rounds"
+             << endl;
+        cout << "interpreted strong parse: " << interpreted << " ms" << endl;
+        cout << "building the parse tree: " << treed << " ms ("
+             << treed / interpreted << "x, " << tree.size() << " nodes, "
+             << tree.bytes() << " B)" << endl;
+        cout << "generated parser: " << generated << " ms" << endl;
+        cout << "speedup: " << interpreted / generated << "x" << endl;
+        if (!ok) return EXIT_FAILURE;
+    }
+    catch (DialectException &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
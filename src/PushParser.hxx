@@ -0,0 +1,168 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PUSH_PARSER_H_INCLUDED
+#define PUSH_PARSER_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "Symbol.hxx"
+#include "GrammarAnalysis.hxx"
+#include "ParseTable.hxx"
+#include "StrongDriver.hxx"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* strong LL(1) push parser */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* driveStrong() turned inside out: the caller hands over input as it arrives
+ * and the parser stops wherever a chunk ends, keeping nothing but its stack
+ * between calls. so a stream of any length is validated in the memory its
+ * parse stack needs. bytes are read the way UserInputReader reads them:
+ * through g.byteTerminals(), with newlines only separating lines. */
+template <typename Grammar, typename Listener = NullParseListener>
+class StrongPushParser {
+private:
+    const Grammar &g;
+    Listener listener;
+    SymbolStack stk;
+    /* input symbols consumed so far */
+    size_t at;
+    enum { RUNNING, ACCEPTED, REJECTED } state;
+    /* runs the parse until in is matched. returns false if it can't be. */
+    bool step(SymbolID in);
+
+public:
+    StrongPushParser(const Grammar &grammar,
+                     const Listener &l = Listener()) : g(grammar),
+                                                      listener(l) {
+        this->reset();
+    }
+
+    ~StrongPushParser(void) { ; }
+
+    /* forgets everything fed so far and starts over */
+    void reset(void);
+
+    /* returns false once the input can no longer be in the language, or
+     * once it has been finished. what is fed after that is ignored. */
+    bool feed(const char *bytes, size_t n);
+
+    /* same, for input that is already symbols */
+    bool feed(SymbolView input);
+
+    /* ends the input. returns whether or not g recognizes it. */
+    bool finish(void);
+
+    bool rejected(void) const { return REJECTED == this->state; }
+
+    /* number of input symbols matched so far */
+    size_t offset(void) const { return this->at; }
+
+    Listener &events(void) { return this->listener; }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename Grammar, typename Listener>
+void
+StrongPushParser<Grammar, Listener>::reset(void)
+{
+    this->stk.clear();
+    this->at = 0;
+    this->state = RUNNING;
+    this->listener.onBegin();
+    this->stk.push(SymbolTable::START);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename Grammar, typename Listener>
+bool
+StrongPushParser<Grammar, Listener>::step(SymbolID in)
+{
+    const Grammar &g = this->g;
+
+    while (!this->stk.empty()) {
+        SymbolID top = this->stk.top();
+        if (g.terminal(top)) {
+            this->stk.pop();
+            if (top != in) break;
+            this->listener.onMatch(top, this->at);
+            if (SymbolTable::END != in) ++this->at;
+            return true;
+        }
+        uint32_t col = g.terminalIndex(in);
+        uint32_t cp = GrammarAnalysis::NONE == col ? ParseTable::ERROR :
+                      g.predict(g.nonTerminalIndex(top), col);
+        if (ParseTable::ERROR == cp) break;
+        this->listener.onPredict(top, in, cp);
+        this->stk.pop();
+        this->stk.push(g.rhsReversed(cp), g.rhsLength(cp));
+    }
+    /* all that is left of the input is in */
+    SymbolView rest = SymbolTable::END == in ? SymbolView() :
+                                               SymbolView(&in, &in + 1);
+    this->state = REJECTED;
+    this->listener.onError(rest, 0, this->stk);
+    return false;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename Grammar, typename Listener>
+bool
+StrongPushParser<Grammar, Listener>::feed(const char *bytes, size_t n)
+{
+    const SymbolID *byteTerminals = this->g.byteTerminals();
+
+    if (RUNNING != this->state) return false;
+    for (size_t b = 0; b < n; ++b) {
+        if ('\n' == bytes[b]) continue;
+        if (!this->step(byteTerminals[uint8_t(bytes[b])])) return false;
+    }
+    return true;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename Grammar, typename Listener>
+bool
+StrongPushParser<Grammar, Listener>::feed(SymbolView input)
+{
+    if (RUNNING != this->state) return false;
+    for (size_t s = 0; s < input.size(); ++s) {
+        if (!this->step(input[s])) return false;
+    }
+    return true;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename Grammar, typename Listener>
+bool
+StrongPushParser<Grammar, Listener>::finish(void)
+{
+    if (RUNNING != this->state) return ACCEPTED == this->state;
+    if (!this->step(SymbolTable::END)) return false;
+    /* $ is the last thing S' derives, so matching it empties the stack */
+    this->listener.onFinish();
+    this->listener.onAccept();
+    this->state = ACCEPTED;
+    return true;
+}
+
+#endif
@@ -0,0 +1,282 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* checks StaticGrammar against the runtime engine. each grammar here is
+ * given to both as the same .cfg text. strong ones are tabled at compile time
+ * and must number and print their symbols and productions as the runtime
+ * does, and take every input over their terminals up to MAX_INPUT symbols
+ * long through the same steps to the same verdict. ones that aren't strong
+ * LL(1) must be refused by both: the runtime can't parse with them, and
+ * building them as StaticGrammars at run time throws what would otherwise
+ * stop the compile. run by make check where the compiler has C++14. */
+
+#include "CFG.hxx"
+#include "DialectException.hxx"
+#include "GrammarImage.hxx"
+#include "LL1Parser.hxx"
+#include "StaticGrammar.hxx"
+
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* longest input tried, and at most how many inputs are tried per grammar */
+static const size_t MAX_INPUT = 8;
+static const size_t MAX_INPUTS = 50000;
+
+/* cfg/text-example-08.cfg */
+static constexpr char TEXT_EXAMPLE_08[] = R"(
+S --> aB
+B --> b
+B --> aBb
+)";
+
+/* cfg/text-example-01.cfg */
+static constexpr char TEXT_EXAMPLE_01[] = R"(
+0 --> 21
+1 --> +21
+1 --> -21
+1 -->
+2 --> 43
+3 --> *43
+3 --> /43
+3 -->
+4 --> n
+4 --> (0)
+)";
+
+/* cfg/text-example-07.cfg */
+static constexpr char TEXT_EXAMPLE_07[] = R"(
+# strings of %s and ?s, nested in parentheses
+S --> FS
+S --> Q
+S --> (S)S
+F --> %s
+Q --> ?s
+)";
+
+/* cfg/test-00.cfg, which is left-recursive */
+static constexpr char TEST_00[] = R"(
+S --> uBDz
+B --> Bv
+B --> w
+D --> EF
+E --> y
+E -->
+F --> x
+F -->
+)";
+
+/* cfg/balanced-pandb.cfg, which is ambiguous */
+static constexpr char BALANCED_PANDB[] = R"(
+S --> SS
+S --> ()
+S --> (S)
+S --> []
+S --> [S]
+)";
+
+/* the strong ones, tabled while this is compiled */
+static constexpr auto STATIC_08 = staticGrammar(TEXT_EXAMPLE_08);
+static constexpr auto STATIC_01 = staticGrammar(TEXT_EXAMPLE_01);
+static constexpr auto STATIC_07 = staticGrammar(TEXT_EXAMPLE_07);
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* every step a parse takes, spelled out */
+class StepRecorder : public NullParseListener {
+public:
+    string steps;
+
+    void onPredict(SymbolID /* nonTerminal */, SymbolID in, size_t p) {
+        this->steps += "p" + to_string(p) + "@" + to_string(in) + " ";
+    }
+
+    void onMatch(SymbolID terminal, size_t offset) {
+        this->steps += "m" + to_string(terminal) + "@" + to_string(offset) +
+                       " ";
+    }
+
+    void onAccept(void) { this->steps += "accept"; }
+
+    void onError(SymbolView, size_t offset, SymbolStack &stk) {
+        this->steps += "stuck@" + to_string(offset) + " with " +
+                       to_string(stk.size()) + " left";
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* text read the way the cfg parser reads it, into a cleaned and crunched
+ * grammar. the caller deletes it. */
+static CFG *
+runtimeCFG(const string &text)
+{
+    SymbolTable symbols;
+    vector<CFGProduction> prods;
+    istringstream lines(text);
+    string line;
+
+    while (getline(lines, line)) {
+        istringstream tokens(line);
+        string lhs, arrow, rhs;
+        if (!(tokens >> lhs) || '#' == lhs[0]) continue;
+        tokens >> arrow >> rhs;
+        prods.push_back(CFGProduction(symbols, lhs, rhs));
+    }
+    CFG *cfg = new CFG(symbols, prods);
+    cfg->clean();
+    cfg->crunch();
+    return cfg;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the first way in which g and the runtime's take on text differ, or "" if
+ * they don't. tried counts the inputs both parsed. */
+template <size_t N>
+static string
+compare(const StaticGrammar<N> &g, const char (&text)[N], size_t &tried)
+{
+    unique_ptr<CFG> cfg(runtimeCFG(text));
+    StrongLL1Parser sll1(*cfg);
+    const GrammarImage &image = sll1.compile();
+
+    if (!image.strong()) return "strong()";
+    if (g.symbols() != image.symbols()) return "symbols()";
+    for (SymbolID id = 0; id < g.symbols(); ++id) {
+        if (g.name(id) != image.name(id)) return "name(" + to_string(id) + ")";
+    }
+    if (g.productions() != image.productions()) return "productions()";
+    for (size_t p = 0; p < g.productions(); ++p) {
+        if (g.str(p) != image.str(p)) return "str(" + to_string(p) + ")";
+    }
+    /* every terminal, and something that spells none */
+    vector<SymbolID> alphabet(1, SymbolTable::NONE);
+    for (size_t b = 0; b < 256; ++b) {
+        if (g.byteTerminals()[b] != image.byteTerminals()[b]) {
+            return "byteTerminals()['" + string(1, char(b)) + "']";
+        }
+        if (SymbolTable::NONE != g.byteTerminals()[b]) {
+            alphabet.push_back(g.byteTerminals()[b]);
+        }
+    }
+    /* every input of each length in turn, as counters in base
+     * alphabet.size(), until there are too many of them */
+    size_t before = tried;
+    for (size_t len = 0, count = 1; len <= MAX_INPUT; ++len) {
+        vector<size_t> digits(len, 0);
+        vector<SymbolID> input(len);
+        for (size_t n = 0; n < count; ++n) {
+            if (MAX_INPUTS == tried - before) return "";
+            for (size_t d = 0, rest = n; d < len; ++d) {
+                digits[d] = rest % alphabet.size();
+                rest /= alphabet.size();
+                input[d] = alphabet[digits[d]];
+            }
+            StepRecorder atCompileTime, atRunTime;
+            bool staticOk = g.parse(input, atCompileTime);
+            bool runtimeOk = sll1.parse(input, atRunTime);
+            ++tried;
+            if (staticOk == runtimeOk &&
+                atCompileTime.steps == atRunTime.steps) {
+                continue;
+            }
+            string spelled;
+            for (SymbolID id : input) spelled += image.name(id);
+            return "the parse of \"" + spelled + "\" (" + atCompileTime.steps +
+                   " vs. " + atRunTime.steps + ")";
+        }
+        count *= alphabet.size();
+    }
+    return "";
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the first way in which g and the runtime don't both refuse text, or "" if
+ * they do. the runtime is refused a parse of sentence, which needs one of the
+ * predictions that conflict. */
+template <size_t N>
+static string
+compareRefusal(const char (&text)[N], const string &sentence)
+{
+    unique_ptr<CFG> cfg(runtimeCFG(text));
+    StrongLL1Parser sll1(*cfg);
+    const GrammarImage &image = sll1.compile();
+    vector<SymbolID> input;
+    string why;
+
+    if (image.strong()) return "the runtime tables it";
+    for (char c : sentence) input.push_back(image.byteTerminals()[uint8_t(c)]);
+    try {
+        sll1.recognize(input);
+        return "the runtime parses with it";
+    }
+    catch (DialectException &e) {
+        why = e.what();
+    }
+    if ("*** grammar is not LL(1) ***" != why) return "the runtime says " + why;
+    try {
+        /* constexpr, but evaluated here so that it can throw */
+        unique_ptr< StaticGrammar<N> > g(new StaticGrammar<N>(text));
+        return "it compiles";
+    }
+    catch (const char *e) {
+        why = e;
+    }
+    if ("grammar is not strong LL(1)" != why) return "it says " + why;
+    return "";
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+static bool
+report(const string &what, const string &diff)
+{
+    if (diff.empty()) return true;
+    cerr << what << ": " << diff << endl;
+    return false;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+int
+main(void)
+{
+    size_t tried = 0;
+    bool ok = true;
+
+    try {
+        ok = report("text-example-08",
+                    compare(STATIC_08, TEXT_EXAMPLE_08, tried)) && ok;
+        ok = report("text-example-01",
+                    compare(STATIC_01, TEXT_EXAMPLE_01, tried)) && ok;
+        ok = report("text-example-07",
+                    compare(STATIC_07, TEXT_EXAMPLE_07, tried)) && ok;
+        ok = report("test-00", compareRefusal(TEST_00, "uwvz")) && ok;
+        ok = report("balanced-pandb",
+                    compareRefusal(BALANCED_PANDB, "()[]")) && ok;
+    }
+    catch (DialectException &e) {
+        cerr << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    if (!ok) return EXIT_FAILURE;
+    cout << tried << " inputs parsed alike by 3 static grammars and the "
+         << "runtime, and 2 grammars refused by both" << endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,474 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STATIC_GRAMMAR_H_INCLUDED
+#define STATIC_GRAMMAR_H_INCLUDED
+
+#if __cplusplus < 201402L
+#error "StaticGrammar.hxx needs a C++14 compiler"
+#endif
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "StrongDriver.hxx"
+
+#include <string>
+#include <vector>
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* compile-time grammar class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a grammar that is analysed and tabled while its program is compiled:
+ *
+ *     constexpr auto g = staticGrammar(R"(
+ *     S --> FS
+ *     S --> (S)S
+ *     F --> %s
+ *     S -->
+ *     )");
+ *
+ * the text is what a .cfg file holds and goes through everything the runtime
+ * does to one: the same symbol numbering, start production, hygiene, nullable,
+ * FIRST, FOLLOW, and LL(1) table. so g.parse() runs the runtime's strong driver
+ * over the same table. a grammar that isn't strong LL(1), or text that isn't a
+ * grammar, fails to compile -- the error's constexpr backtrace says why.
+ * nothing here does what dialect --rewrite does: grammars are taken as
+ * written, so a left-recursive or unfactored one has to be given in the form
+ * --rewrite lists in its verbose output. capacities are worked out from the
+ * length of the text. the header is all there is: neither it nor the driver
+ * needs anything of dialect's linked in. */
+template <size_t N>
+class StaticGrammar {
+public:
+    /* distinct characters plus $ and S' */
+    static constexpr size_t MAX_SYMBOLS = N + 2 < 258 ? N + 2 : 258;
+    /* a production takes at least five characters and a newline */
+    static constexpr size_t MAX_PRODUCTIONS = N / 6 + 2;
+    static constexpr size_t MAX_RHS = N + 2;
+    static constexpr size_t WORDS = (MAX_SYMBOLS + 63) / 64;
+
+private:
+    static constexpr SymbolID END = SymbolTable::END;
+    static constexpr SymbolID START = SymbolTable::START;
+    static constexpr SymbolID NONE = SymbolTable::NONE;
+
+    /* the character every symbol past START stands for */
+    char chars[MAX_SYMBOLS] {};
+    size_t nsymbols = 2;
+    /* terminal flag and whether or not the symbol is in some production */
+    bool kinds[MAX_SYMBOLS] {};
+    bool used[MAX_SYMBOLS] {};
+    /* productions, in compressed sparse row form */
+    size_t nprods = 0;
+    SymbolID lhss[MAX_PRODUCTIONS] {};
+    uint32_t rhsOffsets[MAX_PRODUCTIONS + 1] {};
+    SymbolID rhss[MAX_RHS] {};
+    /* each right-hand side back to front, see GrammarImage::rhsReversed() */
+    SymbolID reversedRhss[MAX_RHS] {};
+    /* one bit per symbol id */
+    uint64_t nullBits[WORDS] {};
+    uint64_t firstBits[MAX_SYMBOLS][WORDS] {};
+    uint64_t followBits[MAX_SYMBOLS][WORDS] {};
+    /* production index plus one, indexed by symbol ids */
+    uint16_t table[MAX_SYMBOLS][MAX_SYMBOLS] {};
+    SymbolID bytes[256] {};
+
+    static_assert(MAX_PRODUCTIONS < UINT16_MAX, "grammar text too long");
+
+    /* reached only by broken grammars, which is what makes them errors */
+    static constexpr void fail(const char *why) { throw why; }
+
+    static constexpr bool symbolChar(char c) {
+        /* what the cfg scanner takes as part of a symbol */
+        return c >= '\45' && c <= '\176';
+    }
+
+    /* the scanner's ARROW, which is only ever a whole token */
+    static constexpr bool arrow(const char *b, const char *e) {
+        return 3 == e - b && '-' == b[0] && '-' == b[1] && '>' == b[2];
+    }
+
+    static constexpr bool test(const uint64_t *bits, size_t i) {
+        return 0 != (bits[i / 64] & (uint64_t(1) << (i % 64)));
+    }
+
+    static constexpr bool set(uint64_t *bits, size_t i) {
+        bool had = test(bits, i);
+        bits[i / 64] |= uint64_t(1) << (i % 64);
+        return !had;
+    }
+
+    static constexpr bool merge(uint64_t *dst, const uint64_t *src) {
+        bool changed = false;
+        for (size_t w = 0; w < WORDS; ++w) {
+            changed = changed || (src[w] & ~dst[w]);
+            dst[w] |= src[w];
+        }
+        return changed;
+    }
+
+    /* SymbolTable::intern() */
+    constexpr SymbolID intern(char c) {
+        for (SymbolID id = 2; id < this->nsymbols; ++id) {
+            if (c == this->chars[id]) return id;
+        }
+        this->chars[this->nsymbols] = c;
+        return this->nsymbols++;
+    }
+
+    constexpr void addProduction(SymbolID lhs, const char *rb, const char *re) {
+        if (MAX_PRODUCTIONS == this->nprods) fail("too many productions");
+        uint32_t at = this->rhsOffsets[this->nprods];
+        this->lhss[this->nprods] = lhs;
+        for (const char *c = rb; c != re; ++c) {
+            this->rhss[at++] = this->intern(*c);
+        }
+        this->rhsOffsets[++this->nprods] = at;
+    }
+
+    /* the cfg scanner and parser: lines are empty, comments, or
+     * "lhs --> [rhs]", with lhs one character. every line ends in a newline.
+     */
+    constexpr void read(const char *text) {
+        size_t i = 0;
+        /* the start production comes first and its rhs is patched in below */
+        this->lhss[0] = START;
+        this->rhsOffsets[1] = 2;
+        this->rhss[1] = END;
+        this->nprods = 1;
+        while (i < N - 1) {
+            if (' ' == text[i] || '\t' == text[i] || '\n' == text[i]) {
+                ++i;
+                continue;
+            }
+            if ('#' == text[i]) {
+                while (i < N - 1 && '\n' != text[i]) ++i;
+                if (N - 1 == i) fail("expected end of line");
+                continue;
+            }
+            /* up to three tokens and the end of the line */
+            size_t tb[3] = {0, 0, 0}, te[3] = {0, 0, 0}, ntok = 0;
+            while (i < N - 1 && '\n' != text[i]) {
+                if (' ' == text[i] || '\t' == text[i]) { ++i; continue; }
+                if (!symbolChar(text[i])) fail("invalid token in grammar");
+                if (3 == ntok) fail("expected end of line");
+                tb[ntok] = i;
+                while (i < N - 1 && symbolChar(text[i])) ++i;
+                te[ntok++] = i;
+            }
+            if (N - 1 == i) fail("expected end of line");
+            if (ntok < 2 || !arrow(text + tb[1], text + te[1]) ||
+                (3 == ntok && arrow(text + tb[2], text + te[2]))) {
+                fail("expected lhs --> rhs");
+            }
+            if (1 != te[0] - tb[0]) {
+                fail("non-terminals must be exactly one ASCII character");
+            }
+            SymbolID lhs = this->intern(text[tb[0]]);
+            this->addProduction(lhs, text + tb[2], text + te[2]);
+        }
+        if (1 == this->nprods) fail("grammar has no productions");
+        this->rhss[0] = this->lhss[1];
+    }
+
+    /* CFG::refresh(): non-terminals are the symbols with productions */
+    constexpr void refresh(void) {
+        for (size_t id = 0; id < this->nsymbols; ++id) this->kinds[id] = true;
+        for (size_t p = 0; p < this->nprods; ++p) {
+            this->kinds[this->lhss[p]] = false;
+        }
+    }
+
+    constexpr bool rhsMarked(size_t p, const bool *marks) const {
+        for (auto s = this->rhsBegin(p); s != this->rhsEnd(p); ++s) {
+            if (!marks[*s]) return false;
+        }
+        return true;
+    }
+
+    /* keeps the productions flagged in keep, in order */
+    constexpr void compact(const bool *keep) {
+        size_t np = 0;
+        uint32_t at = 0;
+        for (size_t p = 0; p < this->nprods; ++p) {
+            if (!keep[p]) continue;
+            uint32_t b = this->rhsOffsets[p], e = this->rhsOffsets[p + 1];
+            this->lhss[np] = this->lhss[p];
+            this->rhsOffsets[np] = at;
+            for (uint32_t s = b; s < e; ++s) this->rhss[at++] = this->rhss[s];
+            ++np;
+        }
+        this->rhsOffsets[np] = at;
+        this->nprods = np;
+    }
+
+    /* CFG::clean(): non-generating productions go first, then unreachable
+     * ones */
+    constexpr void clean(void) {
+        bool marks[MAX_SYMBOLS] {};
+        bool keep[MAX_PRODUCTIONS] {};
+
+        for (size_t id = 0; id < this->nsymbols; ++id) {
+            marks[id] = this->kinds[id];
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t p = 0; p < this->nprods; ++p) {
+                if (marks[this->lhss[p]] || !this->rhsMarked(p, marks)) {
+                    continue;
+                }
+                marks[this->lhss[p]] = changed = true;
+            }
+        }
+        for (size_t p = 0; p < this->nprods; ++p) {
+            keep[p] = marks[this->lhss[p]] && this->rhsMarked(p, marks);
+        }
+        this->compact(keep);
+        for (size_t id = 0; id < this->nsymbols; ++id) marks[id] = false;
+        marks[START] = true;
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t p = 0; p < this->nprods; ++p) {
+                if (!marks[this->lhss[p]]) continue;
+                for (auto s = this->rhsBegin(p); s != this->rhsEnd(p); ++s) {
+                    if (!marks[*s]) marks[*s] = changed = true;
+                }
+            }
+        }
+        for (size_t p = 0; p < this->nprods; ++p) {
+            keep[p] = marks[this->lhss[p]];
+        }
+        this->compact(keep);
+        if (0 == this->nprods || START != this->lhss[0]) {
+            fail("grammar generates nothing");
+        }
+    }
+
+    /* CFG::crunch() */
+    constexpr void crunch(void) {
+        this->refresh();
+        for (size_t p = 0; p < this->nprods; ++p) {
+            this->used[this->lhss[p]] = true;
+            for (auto s = this->rhsBegin(p); s != this->rhsEnd(p); ++s) {
+                this->used[*s] = true;
+            }
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t p = 0; p < this->nprods; ++p) {
+                if (this->rhsNullable(p, this->rhsBegin(p))) {
+                    changed = set(this->nullBits, this->lhss[p]) || changed;
+                }
+            }
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t p = 0; p < this->nprods; ++p) {
+                uint64_t *first = this->firstBits[this->lhss[p]];
+                for (auto s = this->rhsBegin(p); s != this->rhsEnd(p); ++s) {
+                    if (this->kinds[*s]) {
+                        changed = set(first, *s) || changed;
+                        break;
+                    }
+                    changed = merge(first, this->firstBits[*s]) || changed;
+                    if (!test(this->nullBits, *s)) break;
+                }
+            }
+        }
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t p = 0; p < this->nprods; ++p) {
+                const uint64_t *follow = this->followBits[this->lhss[p]];
+                for (auto s = this->rhsBegin(p); s != this->rhsEnd(p); ++s) {
+                    if (this->kinds[*s]) continue;
+                    uint64_t predict[WORDS] {};
+                    this->rhsPredict(p, s + 1, predict);
+                    changed = merge(this->followBits[*s], predict) || changed;
+                    if (this->rhsNullable(p, s + 1)) {
+                        changed = merge(this->followBits[*s], follow) ||
+                                  changed;
+                    }
+                }
+            }
+        }
+    }
+
+    constexpr bool rhsNullable(size_t p, const SymbolID *from) const {
+        for (auto s = from; s != this->rhsEnd(p); ++s) {
+            if (this->kinds[*s] || !test(this->nullBits, *s)) return false;
+        }
+        return true;
+    }
+
+    /* FIRST of production p's right-hand side from from on */
+    constexpr void rhsPredict(size_t p,
+                              const SymbolID *from,
+                              uint64_t *out) const {
+        for (auto s = from; s != this->rhsEnd(p); ++s) {
+            if (this->kinds[*s]) {
+                set(out, *s);
+                return;
+            }
+            merge(out, this->firstBits[*s]);
+            if (!test(this->nullBits, *s)) return;
+        }
+    }
+
+    /* StrongLL1Parser::initTable(), except that conflicts are errors */
+    constexpr void initTable(void) {
+        for (size_t p = 0; p < this->nprods; ++p) {
+            uint64_t predict[WORDS] {};
+            SymbolID lhs = this->lhss[p];
+            this->rhsPredict(p, this->rhsBegin(p), predict);
+            if (this->rhsNullable(p, this->rhsBegin(p))) {
+                merge(predict, this->followBits[lhs]);
+            }
+            for (size_t t = 0; t < this->nsymbols; ++t) {
+                if (!test(predict, t)) continue;
+                if (0 != this->table[lhs][t]) {
+                    fail("grammar is not strong LL(1)");
+                }
+                this->table[lhs][t] = p + 1;
+            }
+        }
+        for (size_t p = 0; p < this->nprods; ++p) {
+            uint32_t b = this->rhsOffsets[p], e = this->rhsOffsets[p + 1];
+            for (uint32_t s = b; s < e; ++s) {
+                this->reversedRhss[s] = this->rhss[b + e - 1 - s];
+            }
+        }
+        /* SymbolTable::byteTerminals() */
+        for (size_t b = 0; b < 256; ++b) this->bytes[b] = NONE;
+        for (SymbolID id = 2; id < this->nsymbols; ++id) {
+            if (this->kinds[id]) {
+                this->bytes[static_cast<unsigned char>(this->chars[id])] = id;
+            }
+        }
+    }
+
+public:
+    constexpr StaticGrammar(const char (&text)[N]) {
+        this->read(text);
+        this->refresh();
+        this->clean();
+        this->crunch();
+        this->initTable();
+    }
+
+    /* the Grammar interface of driveStrong(). the special names are spelled
+     * out as SymbolTable spells them, whose strings are in Symbol.cxx. */
+    std::string name(SymbolID id) const {
+        if (END == id) return "$";
+        if (START == id) return "S'";
+        /* NONE included */
+        if (id >= this->nsymbols) return "_0xDEADBEEF_";
+        return std::string(1, this->chars[id]);
+    }
+
+    std::string str(size_t p) const {
+        std::string res = this->name(this->lhs(p)) + " --> ";
+
+        if (this->rhsBegin(p) == this->rhsEnd(p)) {
+            return res + " ";
+        }
+        for (auto s = this->rhsBegin(p); s != this->rhsEnd(p); ++s) {
+            res += this->name(*s);
+        }
+        return res;
+    }
+
+    /* grammars are compiled as written */
+    std::string originStr(size_t /* p */) const { return std::string(); }
+
+    constexpr bool terminal(SymbolID id) const { return this->kinds[id]; }
+
+    /* rows and columns are symbol ids */
+    uint32_t terminalIndex(SymbolID id) const {
+        return id < this->nsymbols && this->used[id] && this->kinds[id] ?
+               id : GrammarAnalysis::NONE;
+    }
+
+    uint32_t nonTerminalIndex(SymbolID id) const {
+        return id < this->nsymbols && this->used[id] && !this->kinds[id] ?
+               id : GrammarAnalysis::NONE;
+    }
+
+    constexpr uint32_t predict(uint32_t r, uint32_t c) const {
+        /* zero wraps around to ParseTable::ERROR */
+        return uint32_t(this->table[r][c]) - 1u;
+    }
+
+    constexpr const SymbolID *rhsBegin(size_t p) const {
+        return this->rhss + this->rhsOffsets[p];
+    }
+
+    constexpr const SymbolID *rhsEnd(size_t p) const {
+        return this->rhss + this->rhsOffsets[p + 1];
+    }
+
+    constexpr size_t rhsLength(size_t p) const {
+        return this->rhsOffsets[p + 1] - this->rhsOffsets[p];
+    }
+
+    constexpr const SymbolID *rhsReversed(size_t p) const {
+        return this->reversedRhss + this->rhsOffsets[p];
+    }
+
+    constexpr size_t symbols(void) const { return this->nsymbols; }
+
+    constexpr size_t productions(void) const { return this->nprods; }
+
+    constexpr SymbolID lhs(size_t p) const { return this->lhss[p]; }
+
+    constexpr bool nullable(SymbolID id) const {
+        return !this->kinds[id] && test(this->nullBits, id);
+    }
+
+    /* see SymbolTable::byteTerminals() */
+    constexpr const SymbolID *byteTerminals(void) const { return this->bytes; }
+
+    /* the runtime's strong parse, traced the way it traces it. returns
+     * whether or not input is recognized. */
+    bool parse(SymbolView input) const {
+        TraceParseListener<StaticGrammar> trace(*this,
+                                                "strong table-driven parse");
+
+        return driveStrong(*this, input, trace);
+    }
+
+    /* the same parse, told to listener instead of traced. returns whether or
+     * not input is recognized. */
+    template <typename Listener>
+    bool parse(SymbolView input, Listener &listener) const {
+        return driveStrong(*this, input, listener);
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <size_t N>
+constexpr StaticGrammar<N>
+staticGrammar(const char (&text)[N])
+{
+    return StaticGrammar<N>(text);
+}
+
+#endif
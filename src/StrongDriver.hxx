@@ -0,0 +1,336 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STRONG_DRIVER_H_INCLUDED
+#define STRONG_DRIVER_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "Constants.hxx"
+#include "DialectException.hxx"
+#include "Symbol.hxx"
+#include "GrammarAnalysis.hxx"
+#include "ParseTable.hxx"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* parse listener classes */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the parse drivers report every step they take to a listener. listeners are
+ * template parameters, so this one, which ignores everything, costs nothing
+ * and leaves only the table lookups. */
+class NullParseListener {
+public:
+    void onBegin(void) { ; }
+
+    /* production was predicted for nonTerminal, looking at in */
+    void onPredict(SymbolID /* nonTerminal */,
+                   SymbolID /* in */,
+                   size_t /* production */) { ; }
+
+    /* terminal matched the input symbol at offset */
+    void onMatch(SymbolID /* terminal */, size_t /* offset */) { ; }
+
+    /* the stack emptied */
+    void onFinish(void) { ; }
+
+    void onAccept(void) { ; }
+
+    /* the parse got stuck at offset, with stk left over */
+    void onError(SymbolView /* input */,
+                 size_t /* offset */,
+                 SymbolStack & /* stk */) { ; }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+template <typename Grammar>
+std::string
+traceInput(const Grammar &g, SymbolID in)
+{
+    return (SymbolTable::NONE == in ? "" : " in: " + g.name(in));
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* production p, followed by what it was rewritten from if it isn't what the
+ * grammar's author wrote */
+template <typename Grammar>
+std::string
+traceProduction(const Grammar &g, size_t p)
+{
+    std::string from = g.originStr(p);
+    return from.empty() ? g.str(p) : g.str(p) + " (" + from + ")";
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the textual trace dialect prints */
+template <typename Grammar>
+class TraceParseListener {
+protected:
+    const Grammar &g;
+    /* what is being traced */
+    std::string what;
+
+public:
+    TraceParseListener(const Grammar &grammar,
+                       const std::string &parse) : g(grammar), what(parse) { ; }
+
+    void onBegin(void) {
+        std::cout << std::endl << "--- starting " << this->what << std::endl;
+    }
+
+    void onPredict(SymbolID nonTerminal, SymbolID in, size_t production) {
+        std::cout << "..." << traceInput(this->g, in)
+                  << " top: " << this->g.name(nonTerminal)
+                  << " action: " << traceProduction(this->g, production)
+                  << std::endl;
+    }
+
+    void onMatch(SymbolID terminal, size_t /* offset */) {
+        std::cout << "+++ match: " << this->g.name(terminal) << std::endl;
+    }
+
+    void onFinish(void) {
+        std::cout << "--- done with " << this->what << std::endl;
+    }
+
+    void onAccept(void) {
+        std::cout << "*** success: input recognized by grammar ***"
+                  << std::endl;
+    }
+
+    void onError(SymbolView input, size_t offset, SymbolStack &stk) {
+        std::cout << "*** failure: input not recognized by grammar ***"
+                  << std::endl;
+        std::cout << "*** begin state dump ***" << std::endl;
+        std::cout << "input empty: "
+                  << (offset == input.size() ? "yes" : "no") << std::endl;
+        for (; offset < input.size(); ++offset) {
+            std::cout << " -- " << this->g.name(input[offset]) << std::endl;
+        }
+        std::cout << "stack empty: " << (stk.empty() ? "yes" : "no")
+                  << std::endl;
+        while (!stk.empty()) {
+            std::cout << " -- " << this->g.name(stk.top()) << std::endl;
+            stk.pop();
+        }
+        std::cout << "*** end state dump ***" << std::endl;
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+inline void
+traceReject(void)
+{
+    std::string estr = "*** failure: input not recognized by grammar ***";
+    throw DialectException(DIALECT_WHERE, estr, false);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* strong LL(1) driver */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the table-driven parse loop, for any Grammar that answers what GrammarImage
+ * does: name(id), str(p), terminal(id), terminalIndex(id),
+ * nonTerminalIndex(id), predict(row, col), rhsLength(p), and rhsReversed(p).
+ * the runtime engine drives GrammarImages and StaticGrammar drives itself,
+ * so both report and accept exactly the same things. input is only ever
+ * read, front to back. a production is pushed with one copy of its reversed
+ * right-hand side, and epsilon pushes nothing. returns whether or not g
+ * recognizes input. */
+template <typename Grammar, typename Listener>
+bool
+driveStrong(const Grammar &g,
+            SymbolView input,
+            Listener &listener,
+            SymbolStack &stk)
+{
+    size_t at = 0;
+
+    /* whatever a failed parse left behind */
+    stk.clear();
+    listener.onBegin();
+    stk.push(SymbolTable::START);
+
+    while (!stk.empty()) {
+        SymbolID top = stk.top();
+        SymbolID in = at == input.size() ? SymbolTable::END : input[at];
+        if (g.terminal(top)) {
+            stk.pop();
+            if (top != in) goto stuck;
+            listener.onMatch(top, at);
+            if (at != input.size()) ++at;
+        }
+        else {
+            uint32_t col = g.terminalIndex(in);
+            uint32_t cp = GrammarAnalysis::NONE == col ? ParseTable::ERROR :
+                          g.predict(g.nonTerminalIndex(top), col);
+            if (ParseTable::ERROR == cp) goto stuck;
+            listener.onPredict(top, in, cp);
+            stk.pop();
+            stk.push(g.rhsReversed(cp), g.rhsLength(cp));
+        }
+    }
+    listener.onFinish();
+    if (at == input.size()) {
+        listener.onAccept();
+        return true;
+    }
+stuck:
+    listener.onError(input, at, stk);
+    return false;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* error recovery */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a syntax error a recovering parse got past */
+struct ParseError {
+    /* offset of the input symbol the parse couldn't take */
+    size_t offset;
+    /* that symbol, END past the end of the input */
+    SymbolID found;
+    /* what was on top of the stack */
+    SymbolID expected;
+};
+
+/* predicts from g's parse table, for driveRecovering() */
+template <typename Grammar>
+class TablePredictor {
+private:
+    const Grammar &g;
+
+public:
+    TablePredictor(const Grammar &grammar) : g(grammar) { ; }
+
+    /* a production or ParseTable::ERROR */
+    uint32_t operator()(SymbolID nonTerminal, SymbolID in) const {
+        uint32_t col = this->g.terminalIndex(in);
+        return GrammarAnalysis::NONE == col ? ParseTable::ERROR :
+               this->g.predict(this->g.nonTerminalIndex(nonTerminal), col);
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* driveStrong() in panic mode: errors are recorded and the parse goes on.
+ * input symbols the grammar has no terminal for, and those right before the
+ * terminal expected, are taken as extra and skipped. otherwise a terminal
+ * that doesn't match is taken as missing and popped, and a non-terminal
+ * without a prediction skips input up to a symbol it can start with, or
+ * pops once the input gets to something that can follow it. input left over
+ * once the start symbol is done is skipped past its first symbol and parsed
+ * as a sentence of its own.
+ * every error pops or skips, so this is one linear pass. errors that come
+ * before anything else was matched are fallout from the last one and aren't
+ * recorded. g also has to answer inFirst(id, t) and inFollow(id, t), and
+ * predict(nonTerminal, in) gives productions. stops after budget errors,
+ * unless budget is 0. returns the offset the parse stopped at. */
+template <typename Grammar, typename Predictor, typename Listener>
+size_t
+driveRecovering(const Grammar &g,
+                const Predictor &predict,
+                SymbolView input,
+                Listener &listener,
+                SymbolStack &stk,
+                size_t budget,
+                std::vector<ParseError> &errors)
+{
+    size_t at = 0;
+    bool recovering = false;
+
+    stk.clear();
+    listener.onBegin();
+    stk.push(SymbolTable::START);
+
+    while (!stk.empty()) {
+        SymbolID top = stk.top();
+        SymbolID in = at == input.size() ? SymbolTable::END : input[at];
+        uint32_t cp = ParseTable::ERROR;
+        if (g.terminal(top) ? top == in :
+                              ParseTable::ERROR != (cp = predict(top, in))) {
+            stk.pop();
+            if (g.terminal(top)) {
+                listener.onMatch(top, at);
+                if (at != input.size()) ++at;
+                recovering = false;
+                continue;
+            }
+            listener.onPredict(top, in, cp);
+            stk.push(g.rhsReversed(cp), g.rhsLength(cp));
+            continue;
+        }
+        if (!recovering) {
+            ParseError e = {at, in, top};
+            errors.push_back(e);
+            if (errors.size() == budget) return at;
+            recovering = true;
+        }
+        if (SymbolTable::END == top) {
+            ++at;
+            stk.pop();
+            stk.push(SymbolTable::START);
+        }
+        else if (SymbolTable::END != in &&
+                 (GrammarAnalysis::NONE == g.terminalIndex(in) ||
+                  (g.terminal(top) && at + 1 != input.size() &&
+                   top == input[at + 1]))) {
+            ++at;
+        }
+        else if (g.terminal(top)) stk.pop();
+        else {
+            for (; at != input.size(); ++at) {
+                if (g.inFirst(top, input[at])) break;
+                if (g.inFollow(top, input[at])) break;
+            }
+            in = at == input.size() ? SymbolTable::END : input[at];
+            if (SymbolTable::END == in || !g.inFirst(top, in) ||
+                ParseTable::ERROR == predict(top, in)) {
+                stk.pop();
+            }
+        }
+    }
+    listener.onFinish();
+    if (errors.empty()) listener.onAccept();
+    return at;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* same, with a stack of its own */
+template <typename Grammar, typename Listener>
+bool
+driveStrong(const Grammar &g, SymbolView input, Listener &listener)
+{
+    SymbolStack stk;
+
+    return driveStrong(g, input, listener, stk);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* traces the parse and throws if g doesn't recognize input */
+template <typename Grammar>
+void
+driveStrong(const Grammar &g, SymbolView input)
+{
+    TraceParseListener<Grammar> trace(g, "strong table-driven parse");
+
+    if (!driveStrong(g, input, trace)) traceReject();
+}
+
+#endif
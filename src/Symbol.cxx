@@ -0,0 +1,97 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "Symbol.hxx"
+
+#include <string>
+
+using namespace std;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* SymbolTable */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+const SymbolID SymbolTable::NONE;
+const SymbolID SymbolTable::END;
+const SymbolID SymbolTable::START;
+
+/* dead symbol */
+const string SymbolTable::DEAD_NAME    = "_0xDEADBEEF_";
+/* this is okay because our parser makes sure that we can never get a space on
+ * either side of any production rule. if this ever changes, then this "special"
+ * character will need to be changed. epsilon is never interned -- it is just
+ * how an empty right-hand side is printed. */
+const string SymbolTable::EPSILON_NAME = " ";
+/* our parser doesn't allow multi-char string, so this is okay */
+const string SymbolTable::START_NAME   = "S'";
+/* our scanner doesn't accept $s, so this is okay */
+const string SymbolTable::END_NAME     = "$";
+
+/* ////////////////////////////////////////////////////////////////////////// */
+SymbolTable::SymbolTable(void)
+{
+    this->intern(SymbolTable::END_NAME);
+    this->intern(SymbolTable::START_NAME);
+    this->terminal(SymbolTable::START, false);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+SymbolID
+SymbolTable::intern(const string &name)
+{
+    auto found = this->ids.find(name);
+    if (this->ids.end() != found) return found->second;
+
+    SymbolID id = static_cast<SymbolID>(this->names.size());
+    this->names.push_back(name);
+    /* at this point we don't know what type the symbol is. */
+    this->terminals.push_back(true);
+    this->ids[name] = id;
+    return id;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+SymbolID
+SymbolTable::find(const string &name) const
+{
+    auto found = this->ids.find(name);
+    return (this->ids.end() == found) ? SymbolTable::NONE : found->second;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+const string &
+SymbolTable::name(SymbolID id) const
+{
+    /* NONE included */
+    if (id >= this->names.size()) return SymbolTable::DEAD_NAME;
+    return this->names[id];
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* anything that isn't a terminal of the grammar maps to NONE so that it can
+ * never be matched */
+void
+SymbolTable::byteTerminals(SymbolID map[256]) const
+{
+    for (unsigned b = 0; b < 256; ++b) {
+        SymbolID id = this->find(string(1, char(b)));
+        if (NONE == id || END == id || !this->terminal(id)) id = NONE;
+        map[b] = id;
+    }
+}
@@ -0,0 +1,232 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SYMBOL_H_INCLUDED
+#define SYMBOL_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/* dense, interned grammar symbol identifier */
+typedef uint32_t SymbolID;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* symbol view class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a run of symbol ids someone else owns, like the parsers' input. cheap to
+ * copy, and whatever owns the ids must outlive it. a view can also be of
+ * bytes, each spelling the symbol a byte-to-terminal table gives for it and
+ * newlines none, so that input read a byte at a time is parsed where it lies
+ * instead of being copied out four bytes a byte. */
+class SymbolView {
+private:
+    const SymbolID *first;
+    const SymbolID *last;
+    /* for a view of bytes, the bytes and what each spells */
+    const char *bytes;
+    const SymbolID *terms;
+    size_t n;
+    /* whether there are no newlines to skip among the bytes */
+    bool dense;
+    /* the byte symbol at is spelled by. parsers read front to back, so
+     * getting to the next symbol is a step or two from here. */
+    mutable const char *cursor;
+    mutable size_t at;
+
+    const char *seek(size_t i) const {
+        if (this->dense) return this->bytes + i;
+        for (; this->at < i; ++this->at) {
+            do ++this->cursor; while ('\n' == *this->cursor);
+        }
+        for (; this->at > i; --this->at) {
+            do --this->cursor; while ('\n' == *this->cursor);
+        }
+        return this->cursor;
+    }
+
+public:
+    SymbolView(void) : first(NULL), last(NULL), bytes(NULL), terms(NULL),
+                       n(0), dense(true), cursor(NULL), at(0) { ; }
+
+    SymbolView(const SymbolID *begin,
+               const SymbolID *end) : first(begin), last(end), bytes(NULL),
+                                      terms(NULL), n(end - begin),
+                                      dense(true), cursor(NULL), at(0) { ; }
+
+    SymbolView(const std::vector<SymbolID> &ids) :
+        first(ids.data()), last(ids.data() + ids.size()), bytes(NULL),
+        terms(NULL), n(ids.size()), dense(true), cursor(NULL), at(0) { ; }
+
+    /* the bytes in [begin, end) read through byteTerminals, as in
+     * SymbolTable::byteTerminals(), newlines skipped. symbols is how many
+     * of the bytes aren't newlines. */
+    SymbolView(const char *begin,
+               const char *end,
+               const SymbolID *byteTerminals,
+               size_t symbols) : first(NULL), last(NULL), bytes(begin),
+                                 terms(byteTerminals), n(symbols),
+                                 dense(size_t(end - begin) == symbols),
+                                 cursor(begin), at(0) {
+        while (0 != symbols && '\n' == *this->cursor) ++this->cursor;
+    }
+
+    /* the ids, or NULL for a view of bytes */
+    const SymbolID *begin(void) const { return this->first; }
+
+    const SymbolID *end(void) const { return this->last; }
+
+    size_t size(void) const { return this->n; }
+
+    bool empty(void) const { return 0 == this->n; }
+
+    SymbolID operator[](size_t i) const {
+        if (NULL == this->terms) return this->first[i];
+        return this->terms[uint8_t(*this->seek(i))];
+    }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* symbol stack class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the parse stack: symbol ids back to back. the first INLINE of them live in
+ * the stack itself, so shallow parses never allocate, and a deep one only
+ * allocates when it outgrows what it has -- a reused stack not even then. */
+class SymbolStack {
+private:
+    enum { INLINE = 64 };
+    SymbolID local[INLINE];
+    /* where the ids go once local is outgrown */
+    std::vector<SymbolID> spill;
+    SymbolID *bottom;
+    size_t n;
+    size_t capacity;
+    /* makes room for at least need ids */
+    void grow(size_t need) {
+        size_t twice = 2 * this->capacity;
+        std::vector<SymbolID> bigger(twice < need ? need : twice);
+
+        memcpy(bigger.data(), this->bottom, this->n * sizeof(SymbolID));
+        this->spill.swap(bigger);
+        this->bottom = this->spill.data();
+        this->capacity = this->spill.size();
+    }
+
+public:
+    SymbolStack(void) : bottom(local), n(0), capacity(INLINE) { ; }
+
+    SymbolStack(const SymbolStack &other) : bottom(local),
+                                            n(0),
+                                            capacity(INLINE) {
+        this->push(other.bottom, other.n);
+    }
+
+    SymbolStack &operator=(const SymbolStack &other) {
+        if (this != &other) {
+            this->n = 0;
+            this->push(other.bottom, other.n);
+        }
+        return *this;
+    }
+
+    ~SymbolStack(void) { ; }
+
+    bool empty(void) const { return 0 == this->n; }
+
+    size_t size(void) const { return this->n; }
+
+    SymbolID top(void) const { return this->bottom[this->n - 1]; }
+
+    void pop(void) { --this->n; }
+
+    void push(SymbolID id) {
+        if (this->n == this->capacity) this->grow(this->n + 1);
+        this->bottom[this->n++] = id;
+    }
+
+    /* pushes count ids at once, leaving ids[count - 1] on top */
+    void push(const SymbolID *ids, size_t count) {
+        if (this->n + count > this->capacity) this->grow(this->n + count);
+        memcpy(this->bottom + this->n, ids, count * sizeof(SymbolID));
+        this->n += count;
+    }
+
+    /* keeps the memory */
+    void clear(void) { this->n = 0; }
+};
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* symbol table class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* interns every grammar symbol to a dense id. everything past the front end
+ * works on ids -- the strings are only kept around for printing. */
+class SymbolTable {
+private:
+    /* string representation of each symbol, indexed by symbol id */
+    std::vector<std::string> names;
+    /* flag indicating whether or not a symbol is a terminal symbol */
+    std::vector<bool> terminals;
+    /* string representation to symbol id map */
+    std::unordered_map<std::string, SymbolID> ids;
+
+public:
+    /* nothing. the ids are initialized here so that the strong driver, and
+     * StaticGrammar with it, need no definitions to link against. */
+    static const SymbolID NONE = UINT32_MAX;
+    /* special terminal symbol, interned first by every symbol table */
+    static const SymbolID END = 0;
+    /* real start symbol, interned second */
+    static const SymbolID START = 1;
+    /* nothing string representation */
+    static const std::string DEAD_NAME;
+    /* epsilon string representation */
+    static const std::string EPSILON_NAME;
+    /* real start symbol string */
+    static const std::string START_NAME;
+    /* special terminal symbol string */
+    static const std::string END_NAME;
+
+    SymbolTable(void);
+
+    ~SymbolTable(void) { ; }
+
+    SymbolID intern(const std::string &name);
+
+    SymbolID find(const std::string &name) const;
+
+    const std::string &name(SymbolID id) const;
+
+    bool terminal(SymbolID id) const { return this->terminals[id]; }
+
+    void terminal(SymbolID id, bool is) { this->terminals[id] = is; }
+
+    size_t size(void) const { return this->names.size(); }
+
+    /* the terminal every input byte spells, NONE where it spells none. index
+     * with the byte as an unsigned char. */
+    void byteTerminals(SymbolID map[256]) const;
+};
+
+#endif
@@ -0,0 +1,110 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "ThreadPool.hxx"
+
+#include <algorithm>
+
+using namespace std;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+ThreadPool::ThreadPool(size_t nthreads) : body(NULL),
+                                          generation(0),
+                                          busy(0),
+                                          stopping(false),
+                                          next(0),
+                                          nitems(0),
+                                          grain(1)
+{
+    for (size_t t = 1; t < nthreads; ++t) {
+        this->workers.push_back(thread(&ThreadPool::work, this));
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+ThreadPool::~ThreadPool(void)
+{
+    {
+        lock_guard<mutex> lock(this->mtx);
+        this->stopping = true;
+    }
+    this->workCV.notify_all();
+    for (thread &t : this->workers) t.join();
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* claims and runs chunks of the current loop until there are none left */
+void
+ThreadPool::drain(void)
+{
+    for (;;) {
+        size_t b = this->next.fetch_add(this->grain);
+        if (b >= this->nitems) return;
+        (*this->body)(b, min(b + this->grain, this->nitems));
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ThreadPool::work(void)
+{
+    size_t seen = 0;
+
+    for (;;) {
+        {
+            unique_lock<mutex> lock(this->mtx);
+            this->workCV.wait(lock, [&] {
+                return this->stopping || seen != this->generation;
+            });
+            if (this->stopping) return;
+            seen = this->generation;
+        }
+        this->drain();
+        {
+            lock_guard<mutex> lock(this->mtx);
+            if (0 == --this->busy) this->doneCV.notify_one();
+        }
+    }
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+ThreadPool::parallelFor(size_t n,
+                        const function<void(size_t, size_t)> &body,
+                        size_t grain)
+{
+    if (0 == n) return;
+    /* not worth waking anybody up */
+    if (this->workers.empty() || n <= grain) {
+        body(0, n);
+        return;
+    }
+    {
+        lock_guard<mutex> lock(this->mtx);
+        this->body = &body;
+        this->nitems = n;
+        this->grain = max(grain, size_t(1));
+        this->next = 0;
+        this->busy = this->workers.size();
+        ++this->generation;
+    }
+    this->workCV.notify_all();
+    this->drain();
+    unique_lock<mutex> lock(this->mtx);
+    this->doneCV.wait(lock, [&] { return 0 == this->busy; });
+    this->body = NULL;
+}
@@ -0,0 +1,84 @@
+/**
+ * Copyright (c) 2013 Samuel K. Gutierrez All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef THREAD_POOL_H_INCLUDED
+#define THREAD_POOL_H_INCLUDED
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* thread pool class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* a fixed set of worker threads that run data-parallel loops. the calling
+ * thread always pitches in, so a pool of size n has n - 1 workers. */
+class ThreadPool {
+private:
+    /* worker threads */
+    std::vector<std::thread> workers;
+    /* protects everything below that isn't atomic */
+    std::mutex mtx;
+    /* signals workers that there is a new loop or that it's time to go */
+    std::condition_variable workCV;
+    /* signals the caller that all workers are done with the current loop */
+    std::condition_variable doneCV;
+    /* current loop body */
+    const std::function<void(size_t, size_t)> *body;
+    /* bumped once per loop so workers can tell loops apart */
+    size_t generation;
+    /* number of workers still busy with the current loop */
+    size_t busy;
+    /* flag indicating whether or not workers should exit */
+    bool stopping;
+    /* next unclaimed iteration of the current loop */
+    std::atomic<size_t> next;
+    /* iteration count of the current loop */
+    size_t nitems;
+    /* iterations claimed at once */
+    size_t grain;
+
+    ThreadPool(const ThreadPool &);
+
+    ThreadPool &operator=(const ThreadPool &);
+
+    void work(void);
+
+    void drain(void);
+
+public:
+    explicit ThreadPool(size_t nthreads);
+
+    ~ThreadPool(void);
+
+    size_t size(void) const { return this->workers.size() + 1; }
+
+    /* runs body(b, e) over chunks of [0, n) on every thread in the pool and
+     * returns once all of [0, n) is done. */
+    void parallelFor(size_t n,
+                     const std::function<void(size_t, size_t)> &body,
+                     size_t grain = 1);
+};
+
+#endif
@@ -16,57 +16,227 @@
  */
 
 #include "UserInputReader.hxx"
+#include "ByteScanner.hxx"
 #include "Constants.hxx"
 #include "DialectException.hxx"
 
 #include <iostream>
-#include <fstream>
-#include <algorithm>
-#include <locale>
-#include <map>
+#include <string>
 #include <vector>
+#include <algorithm>
 
 #include <errno.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#ifdef HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
 
 using namespace std;
 
+/* what stdin and pipes are read in */
+static const size_t CHUNK_BYTES = size_t(1) << 20;
+
+/* ////////////////////////////////////////////////////////////////////////// */
+UserInputReader::UserInputReader(const string &fileToParse,
+                                 const CFG &cfg,
+                                 bool stream) :
+    map(NULL), mapBytes(0), fd(-1), first(NULL), nbytes(0), unknown(0),
+    newlines(0), lexedYet(false)
+{
+    SymbolID byteTerminals[256];
+
+    cfg.symbols().byteTerminals(byteTerminals);
+    if (!cfg.tokens().empty()) {
+        this->lexTables = LexerTables(cfg.tokens(), cfg.symbols());
+    }
+    this->init(fileToParse, byteTerminals, this->lexTables.lexer(), stream);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+UserInputReader::UserInputReader(const string &fileToParse,
+                                 const GrammarImage &image,
+                                 bool stream) :
+    map(NULL), mapBytes(0), fd(-1), first(NULL), nbytes(0), unknown(0),
+    newlines(0), lexedYet(false)
+{
+    this->init(fileToParse, image.byteTerminals(), image.lexer(), stream);
+}
+
 /* ////////////////////////////////////////////////////////////////////////// */
-UserInputReader::UserInputReader(const string &fileToParse)
+UserInputReader::UserInputReader(const string &fileToParse,
+                                 const SymbolID *byteTerminals) :
+    map(NULL), mapBytes(0), fd(-1), first(NULL), nbytes(0), unknown(0),
+    newlines(0), lexedYet(false)
+{
+    this->init(fileToParse, byteTerminals, Lexer(), false);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+UserInputReader::~UserInputReader(void)
+{
+#ifdef HAVE_SYS_MMAN_H
+    if (NULL != this->map) munmap(this->map, this->mapBytes);
+#endif
+    if (-1 != this->fd && STDIN_FILENO != this->fd) close(this->fd);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+UserInputReader::init(const string &fileToParse,
+                      const SymbolID *byteTerminals,
+                      const Lexer &lex,
+                      bool stream)
+{
+    memcpy(this->byteTerms, byteTerminals, sizeof(this->byteTerms));
+    this->lexer = lex;
+    this->read(fileToParse, stream && this->lexer.empty());
+    this->unknown = this->nbytes;
+    if (this->lexed() || this->streamed()) return;
+    ByteScanner scanner(this->byteTerms);
+    this->unknown = scanner.scan(this->begin(), this->end(), this->newlines);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+UserInputReader::read(const string &fileToParse, bool stream)
 {
     string line;
 
     if ("-" == fileToParse) {
-        cout << "dialect: ";
-        istream *in = &cin;
-        getline(*in, line);
-        /* break it up into pieces */
-        for (unsigned long c = 0; c < line.length(); ++c) {
-            char *cp = &line[c];
-            this->_input.push_back(Symbol(string(cp, 1)));
+        /* a person at a terminal gets a prompt and a line, as always */
+        if (isatty(STDIN_FILENO)) {
+            cout << "dialect: ";
+            getline(cin, line);
+            this->buffer.assign(line.begin(), line.end());
+            this->first = this->buffer.data();
+            this->nbytes = this->buffer.size();
+        }
+        else if (stream) {
+            this->fd = STDIN_FILENO;
+            this->what = "stdin";
         }
+        else this->slurp(STDIN_FILENO, "stdin");
+        return;
     }
-    else {
-        ifstream *file;
-        file = new ifstream(fileToParse.c_str());
-        /* problem opening the file */
-        if (!file->is_open()) {
+    int fd = open(fileToParse.c_str(), O_RDONLY);
+    struct stat sb;
+    if (-1 == fd || -1 == fstat(fd, &sb)) {
+        int err = errno;
+        if (-1 != fd) close(fd);
+        string eStr = "cannot open " + fileToParse +
+                      ". " + strerror(err) + ".\n";
+        throw DialectException(DIALECT_WHERE, eStr);
+    }
+#ifdef HAVE_SYS_MMAN_H
+    if (S_ISREG(sb.st_mode) && 0 < sb.st_size) {
+        void *m = mmap(NULL, sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (MAP_FAILED != m) {
+            /* read front to back, once */
+            madvise(m, sb.st_size, MADV_SEQUENTIAL);
+            this->map = m;
+            this->mapBytes = sb.st_size;
+            this->first = static_cast<const char *>(m);
+            this->nbytes = sb.st_size;
+            close(fd);
+            return;
+        }
+    }
+#endif
+    if (stream) {
+        this->fd = fd;
+        this->what = fileToParse;
+        return;
+    }
+    this->slurp(fd, fileToParse);
+    close(fd);
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+void
+UserInputReader::slurp(int fd, const string &what)
+{
+    size_t have = 0;
+
+    for (;;) {
+        if (this->buffer.size() - have < CHUNK_BYTES) {
+            this->buffer.resize(have + CHUNK_BYTES);
+        }
+        ssize_t n = ::read(fd, this->buffer.data() + have,
+                           this->buffer.size() - have);
+        if (-1 == n && EINTR == errno) continue;
+        if (-1 == n) {
+            int err = errno;
+            string eStr = "cannot read " + what + ". " + strerror(err) + ".\n";
+            throw DialectException(DIALECT_WHERE, eStr);
+        }
+        if (0 == n) break;
+        have += n;
+    }
+    this->buffer.resize(have);
+    this->first = this->buffer.data();
+    this->nbytes = have;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+bool
+UserInputReader::stream(StrongPushParser<GrammarImage> &parser)
+{
+    /* the only copy of the input there ever is */
+    vector<char> chunk(CHUNK_BYTES);
+    ByteScanner scanner(this->byteTerms);
+    /* going while parser takes what it is fed, clean while every byte
+     * spells a terminal or is a newline */
+    bool going = true, clean = true;
+
+    while (-1 != this->fd && (going || clean)) {
+        ssize_t n = ::read(this->fd, chunk.data(), chunk.size());
+        if (-1 == n && EINTR == errno) continue;
+        if (-1 == n) {
             int err = errno;
-            string eStr = "cannot open " + fileToParse +
-                          ". " + strerror(err) + ".\n";
+            string eStr = "cannot read " + this->what + ". " +
+                          strerror(err) + ".\n";
             throw DialectException(DIALECT_WHERE, eStr);
         }
-        /* start building the strings */
-        while (file->good()) {
-            getline(*file, line);
-            /* break it up into pieces */
-            for (unsigned long c = 0; c < line.length(); ++c) {
-                char *cp = &line[c];
-                this->_input.push_back(Symbol(string(cp, 1)));
+        if (0 == n) break;
+        if (clean) {
+            size_t dropped = 0;
+            size_t u = scanner.scan(chunk.data(), chunk.data() + n, dropped);
+            this->newlines += dropped;
+            if (size_t(n) != u) {
+                this->unknown = this->nbytes + u;
+                clean = false;
             }
         }
-        /* close the file */
-        file->close();
-        delete file;
+        if (going) going = parser.feed(chunk.data(), n);
+        this->nbytes += n;
+    }
+    if (clean) this->unknown = this->nbytes;
+    if (-1 != this->fd && STDIN_FILENO != this->fd) close(this->fd);
+    this->fd = -1;
+    return going && parser.finish();
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+SymbolView
+UserInputReader::input(void) const
+{
+    if (!this->lexed()) {
+        /* the scan counted the newlines up to where it stopped */
+        size_t newlines = this->newlines;
+        if (this->unknown != this->nbytes) {
+            newlines += count(this->begin() + this->unknown, this->end(), '\n');
+        }
+        return SymbolView(this->begin(), this->end(), this->byteTerms,
+                          this->nbytes - newlines);
+    }
+    if (!this->lexedYet) {
+        this->lexedYet = true;
+        size_t n = this->lexer.lex(this->begin(), this->end(), this->tokens);
+        if (n != this->nbytes) this->tokens.push_back(SymbolTable::NONE);
     }
+    return SymbolView(this->tokens);
 }
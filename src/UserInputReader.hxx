@@ -20,22 +20,119 @@
 
 #include "Base.hxx"
 #include "CFG.hxx"
+#include "GrammarImage.hxx"
+#include "Lexer.hxx"
+#include "PushParser.hxx"
 
 #include <string>
 #include <vector>
 
+/* ////////////////////////////////////////////////////////////////////////// */
+/* user input reader class */
+/* ////////////////////////////////////////////////////////////////////////// */
+/* the input to parse, as bytes. files are mmap()ed read-only where they can
+ * be, so a file of any size costs only the page cache. stdin, pipes, and
+ * whatever else can't be mapped are read in large chunks instead, or, if
+ * the reader is told it may stream them, read through one fixed buffer by
+ * stream() and never kept. bytes are
+ * read through a 256-entry table of the terminal each spells, newlines only
+ * separating lines, or are lexed if the grammar has token rules. unlexed
+ * input is checked against the grammar's terminals by a ByteScanner as soon
+ * as it is read, and is parsed straight off its bytes. only the lexer's
+ * tokens are ever made into symbols, and only if someone asks for them. */
 class UserInputReader {
 private:
-    std::vector<Symbol> _input;
+    /* the file, when it could be mapped */
+    void *map;
+    size_t mapBytes;
+    /* otherwise, everything read from it */
+    std::vector<char> buffer;
+    /* or what is still to be read, by stream(), and what it is called */
+    int fd;
+    std::string what;
+    /* the input's bytes, in map or in buffer */
+    const char *first;
+    size_t nbytes;
+    /* see SymbolTable::byteTerminals() */
+    SymbolID byteTerms[256];
+    /* owns the lexer's tables when there is no image to */
+    LexerTables lexTables;
+    Lexer lexer;
+    /* see unknownAt() */
+    size_t unknown;
+    /* newlines before it */
+    size_t newlines;
+    /* what the lexer makes of the input, once input() asks */
+    mutable std::vector<SymbolID> tokens;
+    mutable bool lexedYet;
+
+    /* the mapping is not shared */
+    UserInputReader(const UserInputReader &);
+
+    UserInputReader &operator=(const UserInputReader &);
+
+    void read(const std::string &fileToParse, bool stream);
+
+    /* everything left in fd, into buffer */
+    void slurp(int fd, const std::string &what);
+
+    /* reads fileToParse, then finds its first unknown byte */
+    void init(const std::string &fileToParse,
+              const SymbolID *byteTerminals,
+              const Lexer &lex,
+              bool stream);
 
 public:
-    UserInputReader(void) { ; }
+    /* lexed if cfg has token rules. if stream, input that can't be mapped
+     * and isn't lexed is left for stream() to read. */
+    UserInputReader(const std::string &fileToParse,
+                    const CFG &cfg,
+                    bool stream = false);
+
+    /* lexed if image has a lexer. stream as above. */
+    UserInputReader(const std::string &fileToParse,
+                    const GrammarImage &image,
+                    bool stream = false);
+
+    /* byteTerminals maps every input byte to its terminal, as in
+     * SymbolTable::byteTerminals() */
+    UserInputReader(const std::string &fileToParse,
+                    const SymbolID *byteTerminals);
+
+    ~UserInputReader(void);
+
+    const char *begin(void) const { return this->first; }
+
+    const char *end(void) const { return this->first + this->nbytes; }
+
+    /* of a streamed input, the bytes stream() read */
+    size_t size(void) const { return this->nbytes; }
+
+    bool lexed(void) const { return !this->lexer.empty(); }
+
+    /* offset of the first byte, newlines aside, that spells no terminal, or
+     * size() if there is none. lexed input is only checked by lexing it. */
+    size_t unknownAt(void) const { return this->unknown; }
+
+    /* the line unknownAt() is on, counting from 1 */
+    size_t unknownLine(void) const { return this->newlines + 1; }
 
-    UserInputReader(const std::string &fileToParse);
+    /* whether the input was left for stream() to read. begin(), end(), and
+     * input() have nothing to give for it, and size() and unknownAt() are
+     * only known once it has been read. */
+    bool streamed(void) const { return !this->what.empty(); }
 
-    ~UserInputReader(void) { ; }
+    /* feeds a streamed input to parser a buffer at a time, and returns
+     * whether parser recognizes it. the input is read to its end even once
+     * parser gives up, so that unknownAt() is the same as if it had been
+     * read whole. */
+    bool stream(StrongPushParser<GrammarImage> &parser);
 
-    std::vector<Symbol> input(void) const { return this->_input; }
+    /* the input as the parsers take it: one terminal per byte with newlines
+     * dropped, read off the bytes as the parse gets to them, or the tokens
+     * the lexer finds, lexed the first time they are asked for. NONE for
+     * whatever spells no terminal. valid for as long as the reader is. */
+    SymbolView input(void) const;
 };
 
 #endif